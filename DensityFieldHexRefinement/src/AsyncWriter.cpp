@@ -0,0 +1,82 @@
+#include "AsyncWriter.h"
+
+/* constructor & destructor for class AsyncWriter, the worker thread is started by the first push() */
+AsyncWriter::AsyncWriter(size_t capacity) : capacity(capacity ? capacity : 1), stopped(false), busy(false)
+{
+}
+
+AsyncWriter::~AsyncWriter()
+{
+    if (!worker.joinable())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopped = true;
+    }
+    notEmpty.notify_all();
+    worker.join();
+}
+
+/*
+ * push()
+ * DESCRIPTION: queue an output job, block while the writer holds capacity jobs, queued or running
+ *              start the worker thread if it is not started yet
+ * INPUT: job - output job owning the data to be written
+ * OUTPUT: none
+ * RETURN: none
+ */
+void AsyncWriter::push(std::function<void()> job)
+{
+    std::unique_lock<std::mutex> lock(mtx);
+    if (!worker.joinable())
+        worker = std::thread(&AsyncWriter::run, this);
+    notFull.wait(lock, [this] { return jobs.size() + busy < capacity; });
+    jobs.push_back(std::move(job));
+    lock.unlock();
+    notEmpty.notify_one();
+}
+
+/*
+ * flush()
+ * DESCRIPTION: wait until all queued jobs are finished
+ * INPUT: none
+ * OUTPUT: none
+ * RETURN: none
+ */
+void AsyncWriter::flush()
+{
+    std::unique_lock<std::mutex> lock(mtx);
+    idle.wait(lock, [this] { return jobs.empty() && !busy; });
+}
+
+/*
+ * run()
+ * DESCRIPTION: worker loop, run jobs in order until stopped and the queue is drained
+ * INPUT: none
+ * OUTPUT: none
+ * RETURN: none
+ */
+void AsyncWriter::run()
+{
+    std::unique_lock<std::mutex> lock(mtx);
+    while (true)
+    {
+        notEmpty.wait(lock, [this] { return stopped || !jobs.empty(); });
+        if (jobs.empty())
+            break;
+
+        std::function<void()> job = std::move(jobs.front());
+        jobs.pop_front();
+        busy = true;
+        lock.unlock();
+
+        job();
+
+        lock.lock();
+        busy = false;
+        notFull.notify_one();
+        if (jobs.empty())
+            idle.notify_all();
+    }
+    idle.notify_all();
+}
@@ -0,0 +1,40 @@
+#ifndef ASYNC_WRITER_H
+#define ASYNC_WRITER_H
+
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <functional>
+#include <condition_variable>
+
+/*
+ * AsyncWriter
+ * DESCRIPTION: background thread running output jobs in order, so that the caller continues immediately
+ *              capacity bounds the jobs held by the writer, the queued ones and the running one, push() blocks
+ *              while it is reached, so at most capacity snapshots are held besides the one being pushed
+ *              jobs must own the data they write, i.e. a snapshot of the mesh
+ *              the thread is started by the first job, a writer without jobs costs nothing
+ *              all jobs are finished before the writer is destroyed
+ */
+class AsyncWriter
+{
+public:
+    explicit AsyncWriter(size_t capacity);
+    ~AsyncWriter();
+
+    void push(std::function<void()> job);
+    void flush();
+
+private:
+    size_t capacity;
+    bool stopped;
+    bool busy;
+    std::deque<std::function<void()>> jobs;
+    std::mutex mtx;
+    std::condition_variable notEmpty, notFull, idle;
+    std::thread worker;
+
+    void run();
+};
+
+#endif
@@ -0,0 +1,878 @@
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <cmath>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <algorithm>
+
+#ifndef _WIN32
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#endif
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "BlockRefine.h"
+#include "MeshStore.h"
+#include "FieldAdaptiveRefine.h"
+#include "HexRefine/TrivialRefine.h"
+
+#define HEX_SIZE 8
+
+/* width of the halo around a block, in the maximum extent of cells, the halo has to cover cells sharing a vertex with the block */
+#define HALO_LAYERS 1
+/* number of cells evaluated at a time when marking, multiple of 64 so processes never share a word of the bitmaps of cells */
+#define MARK_CHUNK 65536
+
+using namespace Eigen;
+
+/* sorted vertexes of a face */
+typedef std::array<int, 4> FaceKey;
+/* corners of a face, or of an edge followed by -1, -1, then the position of a vertex on the face or edge, see getSeamKey() */
+typedef std::array<int, 5> SeamKey;
+
+/* vertexes of each face of a hex cell */
+static const int HexFace[6][4] = {{0, 1, 2, 3}, {4, 5, 6, 7}, {0, 1, 5, 4}, {1, 2, 6, 5}, {2, 3, 7, 6}, {3, 0, 4, 7}};
+/* position of each corner of a hex cell in its parametric space */
+static const int HexCorner[HEX_SIZE][3] = {{0, 0, 0}, {1, 0, 0}, {1, 1, 0}, {0, 1, 0}, {0, 0, 1}, {1, 0, 1}, {1, 1, 1}, {0, 1, 1}};
+
+/*
+ * RcbNode
+ * DESCRIPTION: node of the recursive coordinate bisection of cells
+ *              cells of the node are CellIdx[begin] ~ CellIdx[end - 1], lo & hi bound boxes of the cells
+ */
+struct RcbNode
+{
+    int begin, end;
+    int left, right; // children, -1 for a leaf
+    Vector3d lo, hi;
+};
+
+/*
+ * BlockOutput
+ * DESCRIPTION: result of refining a block
+ *              vertex index v < vnum of the input refers to a vertex of the input, otherwise to V[v - vnum]
+ */
+struct BlockOutput
+{
+    HexVertexes V;              // added vertexes
+    std::vector<SeamKey> Seam;  // key of each added vertex that may be added by other blocks as well, Seam[i][0] = -1 for other vertexes
+    std::vector<HexCell> C;     // children of cells of the block
+    std::vector<FaceKey> SeamF; // faces shared by children of cells of the block and children of halo cells
+};
+
+/*
+ * getCellBox()
+ * DESCRIPTION: get the bounding box of a cell
+ * INPUT: V, C - mesh
+ *        cIdx - index of the cell
+ * OUTPUT: lo, hi - corners of the bounding box
+ * RETURN: none
+ */
+static void getCellBox(const Ref<const Matrix3Xd> &V, const Ref<const MatrixXi> &C, int cIdx, Vector3d &lo, Vector3d &hi)
+{
+    lo = hi = V.col(C(0, cIdx));
+    for (int j = 1; j < HEX_SIZE; j++)
+    {
+        lo = lo.cwiseMin(V.col(C(j, cIdx)));
+        hi = hi.cwiseMax(V.col(C(j, cIdx)));
+    }
+}
+
+/*
+ * buildRcb()
+ * DESCRIPTION: bisect cells recursively at the median of cell centers along the longest axis,
+ *              until a node has no more than leafCellNum cells
+ * INPUT: V, C - mesh
+ *        CellIdx - indexes of cells, reordered so that cells of each node are contiguous
+ *        begin, end - range of the node in CellIdx
+ *        leafCellNum - maximum number of cells of a leaf
+ * OUTPUT: nodes - nodes of the bisection, the root is the first
+ *         leaves - indexes of leaves, from left to right
+ * RETURN: index of the node
+ */
+static int buildRcb(const Ref<const Matrix3Xd> &V, const Ref<const MatrixXi> &C, std::vector<int> &CellIdx,
+                    int begin, int end, int leafCellNum, std::vector<RcbNode> &nodes, std::vector<int> &leaves)
+{
+    RcbNode node;
+    node.begin = begin;
+    node.end = end;
+    node.left = node.right = -1;
+    node.lo = Vector3d::Constant(INFINITY);
+    node.hi = Vector3d::Constant(-INFINITY);
+
+    Vector3d clo = node.lo, chi = node.hi;
+    for (int i = begin; i < end; i++)
+    {
+        Vector3d lo, hi;
+        getCellBox(V, C, CellIdx.at(i), lo, hi);
+        node.lo = node.lo.cwiseMin(lo);
+        node.hi = node.hi.cwiseMax(hi);
+        clo = clo.cwiseMin((lo + hi) / 2);
+        chi = chi.cwiseMax((lo + hi) / 2);
+    }
+
+    const int nIdx = nodes.size();
+    nodes.push_back(node);
+    if (end - begin <= leafCellNum)
+    {
+        leaves.push_back(nIdx);
+        return nIdx;
+    }
+
+    int axis;
+    (chi - clo).maxCoeff(&axis);
+    auto center = [&](int cIdx)
+    {
+        double c = 0;
+        for (int j = 0; j < HEX_SIZE; j++)
+            c += V(axis, C(j, cIdx));
+        return c;
+    };
+    const int mid = begin + (end - begin) / 2;
+    std::nth_element(CellIdx.begin() + begin, CellIdx.begin() + mid, CellIdx.begin() + end,
+                     [&](int a, int b) { return center(a) < center(b); });
+
+    const int left = buildRcb(V, C, CellIdx, begin, mid, leafCellNum, nodes, leaves);
+    const int right = buildRcb(V, C, CellIdx, mid, end, leafCellNum, nodes, leaves);
+    nodes.at(nIdx).left = left;
+    nodes.at(nIdx).right = right;
+    return nIdx;
+}
+
+/*
+ * getHalo()
+ * DESCRIPTION: get cells of other leaves whose bounding boxes intersect the given box
+ * INPUT: V, C - mesh
+ *        CellIdx, nodes - recursive coordinate bisection
+ *        nIdx - node to be searched
+ *        leaf - leaf of the block, skipped
+ *        lo, hi - corners of the box
+ * OUTPUT: HaloC - indexes of cells of the halo
+ * RETURN: none
+ */
+static void getHalo(const Ref<const Matrix3Xd> &V, const Ref<const MatrixXi> &C, const std::vector<int> &CellIdx,
+                    const std::vector<RcbNode> &nodes, int nIdx, int leaf, const Vector3d &lo, const Vector3d &hi, std::vector<int> &HaloC)
+{
+    const RcbNode &node = nodes.at(nIdx);
+    if (nIdx == leaf || (node.lo.array() > hi.array()).any() || (node.hi.array() < lo.array()).any())
+        return;
+
+    if (node.left != -1)
+    {
+        getHalo(V, C, CellIdx, nodes, node.left, leaf, lo, hi, HaloC);
+        getHalo(V, C, CellIdx, nodes, node.right, leaf, lo, hi, HaloC);
+        return;
+    }
+
+    for (int i = node.begin; i < node.end; i++)
+    {
+        Vector3d clo, chi;
+        getCellBox(V, C, CellIdx.at(i), clo, chi);
+        if ((clo.array() <= hi.array()).all() && (chi.array() >= lo.array()).all())
+            HaloC.push_back(CellIdx.at(i));
+    }
+}
+
+/*
+ * getSeamKey()
+ * DESCRIPTION: get the key of a vertex added on a face or an edge of its parent cell, the key only depends on the topology,
+ *              so cells on both sides of a seam give the vertex the same key:
+ *              corners of the face or edge starting from the one with the smallest global index, then the position of the vertex
+ *              on the 1/3 subdivision of the face or edge, which every template vertex on the boundary of a cell lies on (see template.md)
+ *              the subdivision point of the parent cell nearest to the vertex is taken as its position
+ * INPUT: V, C - mesh
+ *        cIdx - index of the parent cell
+ *        v - added vertex
+ * OUTPUT: key - key of the vertex
+ * RETURN: true if success, false if the vertex is not on a face or an edge of the parent cell
+ */
+static bool getSeamKey(const Ref<const Matrix3Xd> &V, const Ref<const MatrixXi> &C, int cIdx, const Vector3d &v, SeamKey &key)
+{
+    /* subdivision point nearest to the vertex, 0 ~ 3 along each parametric axis */
+    int g[3] = {0, 0, 0};
+    double minDist = INFINITY;
+    for (int i = 0; i < 64; i++)
+    {
+        const int p[3] = {i % 4, i / 4 % 4, i / 16};
+        Vector3d x = Vector3d::Zero();
+        for (int j = 0; j < HEX_SIZE; j++)
+        {
+            double w = 1;
+            for (int d = 0; d < 3; d++)
+                w *= HexCorner[j][d] ? p[d] / 3.0 : 1 - p[d] / 3.0;
+            x += w * V.col(C(j, cIdx));
+        }
+        const double dist = (x - v).squaredNorm();
+        if (dist < minDist)
+        {
+            minDist = dist;
+            std::copy(p, p + 3, g);
+        }
+    }
+
+    /* global index of the corner at the given parametric position */
+    auto corner = [&](const int u[3])
+    {
+        for (int j = 0; j < HEX_SIZE; j++)
+            if (HexCorner[j][0] == u[0] && HexCorner[j][1] == u[1] && HexCorner[j][2] == u[2])
+                return C(j, cIdx);
+        return -1;
+    };
+
+    int freeAxis[3], freeNum = 0;
+    int u[3];
+    for (int d = 0; d < 3; d++)
+    {
+        u[d] = g[d] / 3;
+        if (g[d] != 0 && g[d] != 3)
+            freeAxis[freeNum++] = d;
+    }
+
+    if (freeNum == 1)
+    {
+        /* edge, from the corner with the smaller index */
+        const int f = freeAxis[0];
+        u[f] = 0;
+        const int e0 = corner(u);
+        u[f] = 1;
+        const int e1 = corner(u);
+        key = (e0 < e1) ? SeamKey{e0, e1, -1, -1, g[f]} : SeamKey{e1, e0, -1, -1, 3 - g[f]};
+        return true;
+    }
+    if (freeNum == 2)
+    {
+        /* face, from the corner with the smallest index towards its neighbor with the smaller index */
+        const int f0 = freeAxis[0], f1 = freeAxis[1];
+        int F[2][2];
+        for (int a = 0; a < 2; a++)
+            for (int b = 0; b < 2; b++)
+            {
+                u[f0] = a;
+                u[f1] = b;
+                F[a][b] = corner(u);
+            }
+        int o0 = 0, o1 = 0;
+        for (int a = 0; a < 2; a++)
+            for (int b = 0; b < 2; b++)
+                if (F[a][b] < F[o0][o1])
+                {
+                    o0 = a;
+                    o1 = b;
+                }
+        const int s0 = o0 ? 3 - g[f0] : g[f0], s1 = o1 ? 3 - g[f1] : g[f1];
+        if (F[1 - o0][o1] < F[o0][1 - o1])
+            key = {F[o0][o1], F[1 - o0][o1], F[1 - o0][1 - o1], F[o0][1 - o1], s0 * 4 + s1};
+        else
+            key = {F[o0][o1], F[o0][1 - o1], F[1 - o0][1 - o1], F[1 - o0][o1], s1 * 4 + s0};
+        return true;
+    }
+    return false;
+}
+
+/*
+ * markCells()
+ * DESCRIPTION: mark cells [begin, end) whose relative density error is beyond tolerance, cells are evaluated in place
+ * INPUT: store - mapped mesh
+ *        evaluator - evaluator with the reference field set
+ *        metric - density metric
+ *        tolerance - tolerance of relative density error
+ *        begin, end - range of cells, begin is a multiple of 64
+ * OUTPUT: MarkBits - one bit per cell, set if marked
+ * RETURN: 0 if success, -1 if failed
+ */
+static int markCells(const MeshStore &store, HexEval::HexEvaluator &evaluator, HexEval::DensityMetric metric, double tolerance,
+                     int begin, int end, uint64_t *MarkBits)
+{
+    const Map<const Matrix3Xd> V = store.getV();
+    const Map<const MatrixXi> C = store.getC();
+
+    for (int cBegin = begin; cBegin < end; cBegin += MARK_CHUNK)
+    {
+        const int n = std::min(MARK_CHUNK, end - cBegin);
+        if (evaluator.EvalDensityField(V, C.middleCols(cBegin, n), metric) == -1)
+            return -1;
+        const std::vector<double> HexDensity = evaluator.GetDensityField();
+        const std::vector<double> RefDensity = evaluator.GetRefDensityField(V, C.middleCols(cBegin, n));
+        for (int i = 0; i < n; i++)
+            if (RefDensity.at(i) - HexDensity.at(i) > tolerance * RefDensity.at(i))
+                MarkBits[(cBegin + i) / 64] |= (uint64_t)1 << ((cBegin + i) % 64);
+    }
+    return 0;
+}
+
+/* whether bit i of a bitmap is set */
+static inline bool getBit(const uint64_t *Bits, size_t i)
+{
+    return (Bits[i / 64] >> (i % 64)) & 1;
+}
+
+/* selected vertex bitmap of a cell, bit j for the vertex j of the cell */
+static unsigned char getCellVbitmap(const Ref<const MatrixXi> &C, int cIdx, const uint64_t *SelectBits)
+{
+    unsigned char Vbitmap = 0;
+    for (int j = 0; j < HEX_SIZE; j++)
+        if (getBit(SelectBits, C(j, cIdx)))
+            Vbitmap |= 1 << j;
+    return Vbitmap;
+}
+
+/*
+ * findPromotedCells()
+ * DESCRIPTION: find cells [begin, end) whose selected vertexes are not a standard configuration,
+ *              i.e. more vertexes have to be selected for a template, see HexRefine::getStandardVbitmap()
+ * INPUT: store - mapped mesh
+ *        SelectBits - one bit per vertex, set if selected
+ *        begin, end - range of cells, begin is a multiple of 64
+ * OUTPUT: PromoteBits - one bit per cell, set if the selection of the cell has to be promoted
+ * RETURN: none
+ */
+static void findPromotedCells(const MeshStore &store, const uint64_t *SelectBits, int begin, int end, uint64_t *PromoteBits)
+{
+    const Map<const MatrixXi> C = store.getC();
+
+    for (int i = begin; i < end; i++)
+    {
+        const unsigned char Vbitmap = getCellVbitmap(C, i, SelectBits);
+        if (Vbitmap && HexRefine::getStandardVbitmap(Vbitmap) != Vbitmap)
+            PromoteBits[i / 64] |= (uint64_t)1 << (i % 64);
+    }
+}
+
+/*
+ * refineBlock()
+ * DESCRIPTION: refine cells of a block together with its halo using trivial method,
+ *              the selection is standard for all cells, so the template of each cell is decided by its selected vertexes
+ *              and only children of cells of the block are output, templates along the seams are the ones of neighbor blocks
+ *              faces shared by children of the block and of the halo are output to be checked for conformity
+ * INPUT: store - mapped mesh
+ *        LocalC - cells of the block followed by cells of the halo
+ *        ownedNum - number of cells of the block
+ *        SelectBits - selected vertexes of all cells
+ * OUTPUT: out - children of cells of the block
+ * RETURN: 0 if success, -1 if failed
+ */
+static int refineBlock(const MeshStore &store, const std::vector<int> &LocalC, int ownedNum, const uint64_t *SelectBits, BlockOutput &out)
+{
+    const Map<const Matrix3Xd> V = store.getV();
+    const Map<const MatrixXi> C = store.getC();
+    const int vnum = V.cols();
+
+    /* gather the local mesh */
+    HexMesh mesh;
+    std::vector<int> LocalV;
+    std::unordered_map<int, int> GlobalToLocal;
+    std::vector<size_t> TargetV;
+    mesh.C.resize(LocalC.size());
+    for (size_t i = 0; i < LocalC.size(); i++)
+    {
+        for (int j = 0; j < HEX_SIZE; j++)
+        {
+            const int gIdx = C(j, LocalC.at(i));
+            auto it = GlobalToLocal.find(gIdx);
+            if (it == GlobalToLocal.end())
+            {
+                it = GlobalToLocal.emplace(gIdx, LocalV.size()).first;
+                LocalV.push_back(gIdx);
+                mesh.V.push_back(V.col(gIdx));
+                if (getBit(SelectBits, gIdx))
+                    TargetV.push_back(it->second);
+            }
+            mesh.C.at(i).at(j) = it->second;
+        }
+    }
+    const size_t oldVNum = mesh.V.size();
+
+    /* refine */
+    std::vector<int> CellOrigin;
+    RefineTree tree;
+    if (TargetV.empty())
+    {
+        tree.ChildOffset.resize(LocalC.size() + 1);
+        tree.ChildC.resize(LocalC.size());
+        for (size_t i = 0; i <= LocalC.size(); i++)
+            tree.ChildOffset.at(i) = i;
+        for (size_t i = 0; i < LocalC.size(); i++)
+            tree.ChildC.at(i) = i;
+    }
+    else if (TrivialRefine(mesh, TargetV, CellOrigin, tree) == -1)
+        return -1;
+
+    /* added vertexes shared with children of halo cells may be added by neighbor blocks as well */
+    std::vector<bool> seam(mesh.V.size(), false);
+    for (int i = tree.ChildOffset.at(ownedNum); i < tree.childNum(); i++)
+        for (int vIdx : mesh.C.at(tree.ChildC.at(i)))
+            seam.at(vIdx) = true;
+
+    /* output children of cells of the block, seam vertexes are keyed by the face or edge of the parent they lie on */
+    std::vector<int> AddedV(mesh.V.size() - oldVNum, -1);
+    for (int p = 0; p < ownedNum; p++)
+        for (int i = tree.ChildOffset.at(p); i < tree.ChildOffset.at(p + 1); i++)
+        {
+            HexCell c = mesh.C.at(tree.ChildC.at(i));
+            for (int &vIdx : c)
+            {
+                if (vIdx < (int)oldVNum)
+                {
+                    vIdx = LocalV.at(vIdx);
+                    continue;
+                }
+                int &aIdx = AddedV.at(vIdx - oldVNum);
+                if (aIdx == -1)
+                {
+                    SeamKey key = {-1, -1, -1, -1, -1};
+                    if (seam.at(vIdx) && !getSeamKey(V, C, LocalC.at(p), mesh.V.at(vIdx), key))
+                    {
+                        std::cout << "seam vertex is not on the boundary of cell " << LocalC.at(p) << std::endl;
+                        return -1;
+                    }
+                    aIdx = out.V.size();
+                    out.V.push_back(mesh.V.at(vIdx));
+                    out.Seam.push_back(key);
+                }
+                vIdx = vnum + aIdx;
+            }
+            out.C.push_back(c);
+        }
+
+    /* number of children of the block & of the halo sharing each face */
+    std::map<FaceKey, std::array<int, 2>> FaceNum;
+    for (int i = 0; i < tree.childNum(); i++)
+    {
+        const HexCell &c = mesh.C.at(tree.ChildC.at(i));
+        for (int f = 0; f < 6; f++)
+        {
+            FaceKey key;
+            for (int j = 0; j < 4; j++)
+                key.at(j) = c.at(HexFace[f][j]);
+            std::sort(key.begin(), key.end());
+            FaceNum[key].at(i < tree.ChildOffset.at(ownedNum) ? 0 : 1)++;
+        }
+    }
+    for (const auto &face : FaceNum)
+    {
+        const std::array<int, 2> &num = face.second;
+        if (num.at(0) && num.at(0) + num.at(1) > 2)
+        {
+            std::cout << "face shared by " << num.at(0) + num.at(1) << " cells after refining a block" << std::endl;
+            return -1;
+        }
+        if (num.at(0) == 1 && num.at(1) == 1)
+        {
+            FaceKey key = face.first;
+            for (int &vIdx : key)
+                vIdx = (vIdx < (int)oldVNum) ? LocalV.at(vIdx) : vnum + AddedV.at(vIdx - oldVNum);
+            out.SeamF.push_back(key);
+        }
+    }
+    return 0;
+}
+
+/*
+ * assembleBlock()
+ * DESCRIPTION: write the result of a block, added vertexes get global indexes, seam vertexes with the same key
+ *              added by different blocks get the same index
+ * INPUT: out - result of the block
+ *        vnum - number of vertexes of the input
+ * OUTPUT: writer - result mesh
+ *         SeamV - global index of each seam vertex
+ *         SeamF - number of blocks having each seam face, a conforming mesh has every seam face in 2 blocks
+ * RETURN: none
+ */
+static void assembleBlock(const BlockOutput &out, int vnum, MeshStoreWriter &writer, std::map<SeamKey, int> &SeamV, std::map<FaceKey, int> &SeamF)
+{
+    std::vector<int> GlobalV(out.V.size());
+    for (size_t i = 0; i < out.V.size(); i++)
+    {
+        const Vector3d &v = out.V.at(i);
+        const SeamKey &key = out.Seam.at(i);
+        if (key.at(0) == -1)
+        {
+            GlobalV.at(i) = writer.addVertex(v);
+            continue;
+        }
+        auto it = SeamV.find(key);
+        if (it == SeamV.end())
+            it = SeamV.emplace(key, writer.addVertex(v)).first;
+        GlobalV.at(i) = it->second;
+    }
+
+    for (HexCell c : out.C)
+    {
+        for (int &vIdx : c)
+            if (vIdx >= vnum)
+                vIdx = GlobalV.at(vIdx - vnum);
+        writer.addCell(c);
+    }
+
+    for (FaceKey f : out.SeamF)
+    {
+        for (int &vIdx : f)
+            if (vIdx >= vnum)
+                vIdx = GlobalV.at(vIdx - vnum);
+        std::sort(f.begin(), f.end());
+        SeamF[f]++;
+    }
+}
+
+/* binary i/o of BlockOutput between worker processes and the main process */
+static void writeBlockOutput(std::ofstream &ofs, const BlockOutput &out)
+{
+    const uint64_t num[3] = {out.V.size(), out.C.size(), out.SeamF.size()};
+    ofs.write((const char *)num, sizeof(num));
+    if (num[0])
+    {
+        ofs.write((const char *)out.V.front().data(), num[0] * sizeof(Vector3d));
+        ofs.write((const char *)out.Seam.data(), num[0] * sizeof(SeamKey));
+    }
+    if (num[1])
+        ofs.write((const char *)out.C.front().data(), num[1] * sizeof(HexCell));
+    if (num[2])
+        ofs.write((const char *)out.SeamF.front().data(), num[2] * sizeof(FaceKey));
+}
+
+static bool readBlockOutput(std::ifstream &ifs, BlockOutput &out)
+{
+    uint64_t num[3];
+    if (!ifs.read((char *)num, sizeof(num)))
+        return false;
+    out.V.resize(num[0]);
+    out.Seam.resize(num[0]);
+    out.C.resize(num[1]);
+    out.SeamF.resize(num[2]);
+    if (num[0])
+    {
+        ifs.read((char *)out.V.front().data(), num[0] * sizeof(Vector3d));
+        ifs.read((char *)out.Seam.data(), num[0] * sizeof(SeamKey));
+    }
+    if (num[1])
+        ifs.read((char *)out.C.front().data(), num[1] * sizeof(HexCell));
+    if (num[2])
+        ifs.read((char *)out.SeamF.front().data(), num[2] * sizeof(FaceKey));
+    return (bool)ifs;
+}
+
+/*
+ * runWorkers()
+ * DESCRIPTION: run task(k) for k = 0 ~ processNum - 1, each in a forked worker process if processNum > 1
+ *              workers share the mapped mesh and memory mapped as shared before forking
+ * INPUT: processNum - number of worker processes
+ *        task - task of each worker, returns 0 if success, -1 if failed
+ * OUTPUT: none
+ * RETURN: 0 if all tasks succeed, -1 if failed
+ */
+template <class Task>
+static int runWorkers(int processNum, Task task)
+{
+#ifndef _WIN32
+    if (processNum > 1)
+    {
+        std::cout.flush();
+        std::vector<pid_t> pids;
+        for (int k = 0; k < processNum; k++)
+        {
+            const pid_t pid = fork();
+            if (pid == 0)
+            {
+#ifdef _OPENMP
+                /* the thread pool of the parent is not inherited */
+                omp_set_num_threads(1);
+#endif
+                const int ret = task(k);
+                std::cout.flush();
+                _exit(ret == 0 ? 0 : 1);
+            }
+            if (pid == -1)
+            {
+                std::cout << "failed to fork a worker process" << std::endl;
+                break;
+            }
+            pids.push_back(pid);
+        }
+
+        int ret = ((int)pids.size() == processNum) ? 0 : -1;
+        for (pid_t pid : pids)
+        {
+            int status;
+            if (waitpid(pid, &status, 0) == -1 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+                ret = -1;
+        }
+        return ret;
+    }
+#endif
+    for (int k = 0; k < processNum; k++)
+        if (task(k) == -1)
+            return -1;
+    return 0;
+}
+
+/*
+ * refineBlocks()
+ * DESCRIPTION: one iteration of block-wise refinement, from a binary mesh file to another
+ *              1. cells are partitioned by recursive coordinate bisection into blocks
+ *              2. workers mark cells of their ranges into a bitmap shared by all workers
+ *              3. vertexes of marked cells are selected into another shared bitmap, then the selection is made standard
+ *                 for the whole mesh: workers find cells of their ranges whose selection has to be promoted,
+ *                 the main process selects the vertexes of their templates, until no worker finds such a cell
+ *              4. workers refine their blocks, each with a halo of cells around it, see refineBlock(),
+ *                 templates are decided by the global selection, so templates along the seams agree
+ *              5. results are assembled, vertexes of the input keep their indexes, added vertexes are renumbered
+ *                 and seam vertexes added by different blocks are shared by their keys, see getSeamKey(),
+ *                 every seam face has to be shared by the children of both blocks, otherwise the iteration fails
+ * INPUT: store - mapped input mesh
+ *        outName - binary mesh file of the result
+ *        evaluator - evaluator with the reference field set
+ *        metric - density metric
+ *        blockCellNum - maximum number of cells per block
+ *        processNum - number of worker processes
+ *        tolerance - tolerance of relative density error, resolved cells are not marked
+ * OUTPUT: writer - refined mesh
+ * RETURN: number of marked cells, -1 if failed
+ */
+static long long refineBlocks(const MeshStore &store, MeshStoreWriter &writer, const std::string &outName, HexEval::HexEvaluator &evaluator,
+                              HexEval::DensityMetric metric, int blockCellNum, int processNum, double tolerance)
+{
+    const Map<const Matrix3Xd> V = store.getV();
+    const Map<const MatrixXi> C = store.getC();
+    const int cnum = C.cols(), vnum = V.cols();
+
+    /* maximum extent of cells */
+    double maxExtent = 0;
+    for (int i = 0; i < cnum; i++)
+    {
+        Vector3d lo, hi;
+        getCellBox(V, C, i, lo, hi);
+        maxExtent = std::max(maxExtent, (hi - lo).maxCoeff());
+    }
+    const double halo = HALO_LAYERS * maxExtent;
+
+    /* partition */
+    std::vector<int> CellIdx(cnum);
+    std::vector<RcbNode> nodes;
+    std::vector<int> leaves;
+    for (int i = 0; i < cnum; i++)
+        CellIdx.at(i) = i;
+    if (cnum)
+        buildRcb(V, C, CellIdx, 0, cnum, std::max(blockCellNum, 1), nodes, leaves);
+    std::cout << "Blocks: " << leaves.size() << ", processes: " << processNum << std::endl;
+
+    /* marks & promotions of cells, selection of vertexes, shared by workers */
+    const size_t wordNum = (cnum + 63) / 64, vWordNum = (vnum + 63) / 64;
+    const size_t sharedSize = std::max(2 * wordNum + vWordNum, (size_t)1) * sizeof(uint64_t);
+    uint64_t *MarkBits;
+#ifndef _WIN32
+    void *shared = mmap(NULL, sharedSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shared == MAP_FAILED)
+    {
+        std::cout << "failed to map shared memory" << std::endl;
+        return -1;
+    }
+    MarkBits = (uint64_t *)shared;
+#else
+    std::vector<uint64_t> MarkWords(sharedSize / sizeof(uint64_t), 0);
+    MarkBits = MarkWords.data();
+#endif
+    uint64_t *PromoteBits = MarkBits + wordNum, *SelectBits = MarkBits + 2 * wordNum;
+
+    long long markedNum = -1;
+    std::map<SeamKey, int> SeamV;
+    std::map<FaceKey, int> SeamF;
+    auto partName = [&](int k) { return outName + ".worker" + std::to_string(k); };
+
+    do
+    {
+        /* mark */
+        const int chunkNum = (cnum + MARK_CHUNK - 1) / MARK_CHUNK;
+        auto cellBegin = [&](int k) { return (int)std::min((long long)chunkNum * k / processNum * MARK_CHUNK, (long long)cnum); };
+        if (runWorkers(processNum, [&](int k)
+                       { return markCells(store, evaluator, metric, tolerance, cellBegin(k), cellBegin(k + 1), MarkBits); }) == -1)
+            break;
+
+        /* select vertexes of marked cells, then promote the selection until it is standard */
+        auto selectCell = [&](int cIdx, unsigned char Vbitmap)
+        {
+            for (int j = 0; j < HEX_SIZE; j++)
+                if ((Vbitmap >> j) & 1)
+                    SelectBits[C(j, cIdx) / 64] |= (uint64_t)1 << (C(j, cIdx) % 64);
+        };
+        for (int i = 0; i < cnum; i++)
+            if (getBit(MarkBits, i))
+                selectCell(i, 0xFF);
+        long long promotedNum = 0;
+        int roundNum = 0;
+        bool failed = false;
+        for (bool promoted = true; promoted; roundNum++)
+        {
+            std::fill(PromoteBits, PromoteBits + wordNum, 0);
+            if (runWorkers(processNum, [&](int k)
+                           { findPromotedCells(store, SelectBits, cellBegin(k), cellBegin(k + 1), PromoteBits);
+                             return 0; }) == -1)
+            {
+                failed = true;
+                break;
+            }
+            promoted = false;
+            for (int i = 0; i < cnum; i++)
+                if (getBit(PromoteBits, i))
+                {
+                    selectCell(i, HexRefine::getStandardVbitmap(getCellVbitmap(C, i, SelectBits)));
+                    promotedNum++;
+                    promoted = true;
+                }
+        }
+        if (failed)
+            break;
+        std::cout << "Selection: " << promotedNum << " cells promoted in " << roundNum << " rounds" << std::endl;
+
+        /* refine, blocks are assigned to workers in contiguous runs so each worker covers a compact region */
+        for (int i = 0; i < vnum; i++)
+            writer.addVertex(V.col(i));
+        auto refineRun = [&](int k, std::ofstream *ofs)
+        {
+            const size_t begin = leaves.size() * k / processNum, end = leaves.size() * (k + 1) / processNum;
+            for (size_t l = begin; l < end; l++)
+            {
+                const RcbNode &leaf = nodes.at(leaves.at(l));
+                std::vector<int> LocalC(CellIdx.begin() + leaf.begin, CellIdx.begin() + leaf.end);
+                getHalo(V, C, CellIdx, nodes, 0, leaves.at(l), leaf.lo - Vector3d::Constant(halo), leaf.hi + Vector3d::Constant(halo), LocalC);
+
+                BlockOutput out;
+                if (refineBlock(store, LocalC, leaf.end - leaf.begin, SelectBits, out) == -1)
+                    return -1;
+                if (ofs)
+                    writeBlockOutput(*ofs, out);
+                else
+                    assembleBlock(out, vnum, writer, SeamV, SeamF);
+            }
+            return (ofs == NULL || ofs->flush()) ? 0 : -1;
+        };
+
+        if (processNum > 1)
+        {
+            if (runWorkers(processNum, [&](int k)
+                           {
+                std::ofstream ofs(partName(k), std::ios::binary | std::ios::trunc);
+                return refineRun(k, &ofs); }) == -1)
+                break;
+
+            /* assemble results of workers */
+            for (int k = 0; k < processNum && !failed; k++)
+            {
+                std::ifstream ifs(partName(k), std::ios::binary);
+                BlockOutput out;
+                while (readBlockOutput(ifs, out))
+                    assembleBlock(out, vnum, writer, SeamV, SeamF);
+                failed = !ifs.eof();
+            }
+            if (failed)
+            {
+                std::cout << "failed to read results of workers" << std::endl;
+                break;
+            }
+        }
+        else if (refineRun(0, NULL) == -1)
+            break;
+
+        /* check conformity along the seams */
+        long long nonconformingNum = 0;
+        for (const auto &face : SeamF)
+            if (face.second != 2)
+                nonconformingNum++;
+        std::cout << "Seam faces: " << SeamF.size() << ", nonconforming: " << nonconformingNum << std::endl;
+        if (nonconformingNum)
+        {
+            std::cout << "the refined mesh is not conforming along seams" << std::endl;
+            break;
+        }
+
+        markedNum = 0;
+        for (size_t w = 0; w < wordNum; w++)
+            for (uint64_t bits = MarkBits[w]; bits; bits &= bits - 1)
+                markedNum++;
+    } while (false);
+
+    for (int k = 0; k < processNum && processNum > 1; k++)
+        std::remove(partName(k).c_str());
+#ifndef _WIN32
+    munmap(shared, sharedSize);
+#endif
+
+    std::cout << "Seam vertexes: " << SeamV.size() << std::endl;
+    return markedNum;
+}
+
+/*
+ * BlockFieldAdaptiveRefine()
+ * DESCRIPTION: refine a mesh larger than memory according to the given density field using trivial method,
+ *              the mesh is mapped from a binary mesh file and refined block by block, see refineBlocks(),
+ *              blocks are processed by worker processes in parallel
+ * INPUT: input - binary mesh file of the input mesh
+ *        output - binary mesh file of the result mesh
+ *        DensityField - scalar function of a 3D vector
+ *        metric - density metric to evaluate the density of a hex cell, having two choices, len or vol metric
+ *        iterNum - number of iteration
+ *        blockCellNum - maximum number of cells per block, 0 for one block per process
+ *        processNum - number of worker processes, workers are not supported on windows
+ *        tolerance - tolerance of relative density error, resolved cells are not marked
+ * OUTPUT: binary mesh file of the result mesh, intermediate files are removed
+ * RETURN: 0 if success, -1 if failed
+ */
+int BlockFieldAdaptiveRefine(const char *input, const char *output, const std::function<double(Vector3d)> &DensityField,
+                             HexEval::DensityMetric metric, int iterNum, int blockCellNum, int processNum, double tolerance)
+{
+    typedef std::chrono::steady_clock Clock;
+    HexEval::HexEvaluator evaluator;
+    std::string inName = input;
+
+#ifdef _WIN32
+    if (processNum > 1)
+        std::cout << "worker processes are not supported on windows, using one process." << std::endl;
+    processNum = 1;
+#endif
+    processNum = std::max(processNum, 1);
+    evaluator.setRefDensityField(DensityField);
+
+    for (int iter = 0; iter < std::max(iterNum, 1); iter++)
+    {
+        const Clock::time_point iterStartTime = Clock::now();
+        const std::string outName = std::string(output) + ".part" + std::to_string(iter % 2);
+        MeshStore store;
+        MeshStoreWriter writer;
+
+        std::cout << "\nRefine Hex Mesh Block by Block..." << std::endl;
+        std::cout << "Iterations:" << iter << "\n" << std::endl;
+        if (store.open(inName.c_str()) == -1 || writer.open(outName.c_str()) == -1)
+            return -1;
+
+        /* with no iteration the input is copied */
+        const int leafCellNum = (blockCellNum > 0) ? blockCellNum : (store.cellNum() + processNum - 1) / processNum;
+        const long long markedNum = refineBlocks(store, writer, outName, evaluator, metric, leafCellNum, processNum, iterNum > 0 ? tolerance : INFINITY);
+        if (markedNum == -1 || writer.close() == -1)
+            return -1;
+
+        std::cout << "Iteration " << iter + 1 << ": " << store.cellNum() << " -> " << writer.cellNum() << " cells, "
+                  << markedNum << " marked, " << std::chrono::duration<double>(Clock::now() - iterStartTime).count() << "s" << std::endl;
+        store.close();
+
+        if (inName != input)
+            std::remove(inName.c_str());
+        inName = outName;
+        if (markedNum == 0)
+            break;
+    }
+
+    std::remove(output);
+    if (std::rename(inName.c_str(), output))
+    {
+        std::cout << "failed to rename " << inName << " to " << output << std::endl;
+        return -1;
+    }
+    std::cout << "Refinement Finished!\n" << std::endl;
+    return 0;
+}
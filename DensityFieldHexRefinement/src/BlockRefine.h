@@ -0,0 +1,12 @@
+#ifndef BLOCK_REFINE_H
+#define BLOCK_REFINE_H
+
+#include <functional>
+#include <eigen3/Eigen/Eigen>
+
+#include "HexEval/HexEval.h"
+
+int BlockFieldAdaptiveRefine(const char *input, const char *output, const std::function<double(Eigen::Vector3d)> &DensityField,
+                             HexEval::DensityMetric metric, int iterNum, int blockCellNum, int processNum, double tolerance);
+
+#endif
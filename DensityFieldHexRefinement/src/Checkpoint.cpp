@@ -0,0 +1,216 @@
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "Checkpoint.h"
+
+/* 
+ * binary snapshot layout, native byte order
+ *     char[8]  magic "DFHRCKPT"
+ *     uint32   version
+ *     int32    iteration, int32 density metric
+ *     uint64   number of vertexes, uint64 number of cells
+ *     double   3 coordinates of each vertex
+ *     int32    8 vertex indexes of each cell
+ *     double   density of each cell
+ *     double   reference density of each cell
+ *     char     marked state of each cell, see RankedMarkTargetHex()
+ */
+static const char CheckpointMagic[8] = {'D', 'F', 'H', 'R', 'C', 'K', 'P', 'T'};
+static const uint32_t CheckpointVersion = 2;
+static const uint64_t CheckpointHeaderSize = sizeof(CheckpointMagic) + sizeof(uint32_t) + 2 * sizeof(int32_t) + 2 * sizeof(uint64_t);
+static const uint64_t CheckpointCellSize = sizeof(HexCell) + 2 * sizeof(double) + sizeof(char);
+
+/*
+ * syncFile()
+ * DESCRIPTION: flush a written file to the disk, so a renamed snapshot is never empty after a crash
+ * INPUT: fname - file name
+ * OUTPUT: none
+ * RETURN: 0 if success, -1 if failed
+ */
+static int syncFile(const char *fname)
+{
+#ifdef _WIN32
+    int fd = _open(fname, _O_RDWR | _O_BINARY);
+    if (fd == -1)
+        return -1;
+    int ret = _commit(fd);
+    _close(fd);
+#else
+    int fd = ::open(fname, O_WRONLY);
+    if (fd == -1)
+        return -1;
+    int ret = fsync(fd);
+    ::close(fd);
+#endif
+    return ret ? -1 : 0;
+}
+
+/*
+ * writeCheckpoint()
+ * DESCRIPTION: write a binary snapshot of the refinement, the snapshot is written into a temporary file
+ *              then renamed over the previous one, so the previous snapshot is kept if writing fails,
+ *              and on posix there is always a complete snapshot
+ * INPUT: fname - snapshot file name
+ *        iteration - number of finished iterations
+ *        metric - density metric of HexDensity
+ *        mesh - current mesh
+ *        HexDensity - density of each cell
+ *        RefDensity - reference density of each cell
+ *        Active - marked state of each cell, empty if none is
+ * OUTPUT: snapshot file
+ * RETURN: 0 if success, -1 if failed
+ */
+int writeCheckpoint(const char *fname, int iteration, int metric, const HexMesh &mesh,
+                    const std::vector<double> &HexDensity, const std::vector<double> &RefDensity, const std::vector<char> &Active)
+{
+    const uint64_t vnum = mesh.V.size(), cnum = mesh.C.size();
+    const int32_t header[2] = {iteration, metric};
+    const std::string tmpName = std::string(fname) + ".tmp";
+
+    if (HexDensity.size() != cnum || RefDensity.size() != cnum || (!Active.empty() && Active.size() != cnum))
+        return -1;
+
+    {
+        std::ofstream ofs(tmpName, std::ios::binary | std::ios::trunc);
+        if (!ofs)
+        {
+            std::cout << "cannot open file " << tmpName << std::endl;
+            return -1;
+        }
+
+        ofs.write(CheckpointMagic, sizeof(CheckpointMagic));
+        ofs.write((const char *)&CheckpointVersion, sizeof(CheckpointVersion));
+        ofs.write((const char *)header, sizeof(header));
+        ofs.write((const char *)&vnum, sizeof(vnum));
+        ofs.write((const char *)&cnum, sizeof(cnum));
+        if (vnum)
+            ofs.write((const char *)mesh.V.front().data(), vnum * sizeof(Eigen::Vector3d));
+        if (cnum)
+        {
+            ofs.write((const char *)mesh.C.front().data(), cnum * sizeof(HexCell));
+            ofs.write((const char *)HexDensity.data(), cnum * sizeof(double));
+            ofs.write((const char *)RefDensity.data(), cnum * sizeof(double));
+            if (Active.empty())
+                ofs.write(std::vector<char>(cnum, false).data(), cnum);
+            else
+                ofs.write(Active.data(), cnum);
+        }
+
+        if (!ofs.flush())
+        {
+            std::cout << "failed to write file " << tmpName << std::endl;
+            return -1;
+        }
+    }
+
+    if (syncFile(tmpName.c_str()))
+    {
+        std::cout << "failed to sync file " << tmpName << std::endl;
+        return -1;
+    }
+
+    /* rename replaces the previous snapshot atomically on posix, on windows it fails if the target exists */
+#ifdef _WIN32
+    std::remove(fname);
+#endif
+    if (std::rename(tmpName.c_str(), fname))
+    {
+        std::cout << "failed to rename " << tmpName << " to " << fname << std::endl;
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * readCheckpoint()
+ * DESCRIPTION: read a binary snapshot of the refinement written by writeCheckpoint()
+ * INPUT: fname - snapshot file name
+ * OUTPUT: iteration - number of finished iterations
+ *         metric - density metric of HexDensity
+ *         mesh - mesh of the snapshot
+ *         HexDensity - density of each cell
+ *         RefDensity - reference density of each cell
+ *         Active - marked state of each cell
+ * RETURN: 0 if success, -1 if failed
+ */
+int readCheckpoint(const char *fname, int &iteration, int &metric, HexMesh &mesh,
+                   std::vector<double> &HexDensity, std::vector<double> &RefDensity, std::vector<char> &Active)
+{
+    std::ifstream ifs(fname, std::ios::binary | std::ios::ate);
+    if (!ifs)
+    {
+        std::cout << "cannot open file " << fname << std::endl;
+        return -1;
+    }
+    const uint64_t fileSize = ifs.tellg();
+    ifs.seekg(0);
+
+    char magic[8];
+    uint32_t version = 0;
+    int32_t header[2];
+    uint64_t vnum = 0, cnum = 0;
+
+    ifs.read(magic, sizeof(magic));
+    ifs.read((char *)&version, sizeof(version));
+    if (!ifs || memcmp(magic, CheckpointMagic, sizeof(magic)) || version != CheckpointVersion)
+    {
+        std::cout << fname << " is not a checkpoint of this version" << std::endl;
+        return -1;
+    }
+    ifs.read((char *)header, sizeof(header));
+    ifs.read((char *)&vnum, sizeof(vnum));
+    ifs.read((char *)&cnum, sizeof(cnum));
+
+    /* bound the sizes by the file before allocating, a corrupted header must not exhaust the memory */
+    if (!ifs || vnum > (fileSize - CheckpointHeaderSize) / sizeof(Eigen::Vector3d) ||
+        cnum > (fileSize - CheckpointHeaderSize - vnum * sizeof(Eigen::Vector3d)) / CheckpointCellSize)
+    {
+        std::cout << fname << " is truncated" << std::endl;
+        return -1;
+    }
+
+    mesh.V.resize(vnum);
+    mesh.C.resize(cnum);
+    HexDensity.resize(cnum);
+    RefDensity.resize(cnum);
+    Active.resize(cnum);
+    if (vnum)
+        ifs.read((char *)mesh.V.front().data(), vnum * sizeof(Eigen::Vector3d));
+    if (cnum)
+    {
+        ifs.read((char *)mesh.C.front().data(), cnum * sizeof(HexCell));
+        ifs.read((char *)HexDensity.data(), cnum * sizeof(double));
+        ifs.read((char *)RefDensity.data(), cnum * sizeof(double));
+        ifs.read(Active.data(), cnum);
+    }
+
+    if (!ifs)
+    {
+        std::cout << fname << " is truncated" << std::endl;
+        return -1;
+    }
+
+    /* reject snapshots referring to missing vertexes */
+    for (const HexCell &c : mesh.C)
+        for (int vIdx : c)
+            if (vIdx < 0 || (uint64_t)vIdx >= vnum)
+            {
+                std::cout << fname << " is corrupted" << std::endl;
+                return -1;
+            }
+
+    iteration = header[0];
+    metric = header[1];
+    return 0;
+}
@@ -0,0 +1,13 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <vector>
+
+#include "HexMesh.h"
+
+int writeCheckpoint(const char *fname, int iteration, int metric, const HexMesh &mesh,
+                    const std::vector<double> &HexDensity, const std::vector<double> &RefDensity, const std::vector<char> &Active);
+int readCheckpoint(const char *fname, int &iteration, int &metric, HexMesh &mesh,
+                   std::vector<double> &HexDensity, std::vector<double> &RefDensity, std::vector<char> &Active);
+
+#endif
@@ -1,15 +1,47 @@
 #include <iostream>
+#include <fstream>
+#include <chrono>
+#include <cstdio>
+#include <algorithm>
+#include <functional>
 #include "FieldAdaptiveRefine.h"
 #include "Utility.hpp"
 #include "MeshIO.h"
+#include "Checkpoint.h"
+#include "AsyncWriter.h"
+#include "RefineHistory.h"
 #include "HexRefine/TrivialRefine.h"
 #include "HexPadding/HexPadding.h"
 #include "HexEval/HexEval.h"
+#include "HexEval/heQuality.h"
+#include "HexEval/heError.h"
 
 #define HEX_SIZE 8
 
+/* estimated peak memory per cell during refinement, including adjacency built by the refine engines */
+#define CELL_MEMORY_BYTES   512
+/* estimated number of new cells per marked cell */
+#define TRIVIAL_CELL_GROWTH 26
+#define PADDING_CELL_GROWTH 6
+/* maximum number of mesh snapshots held by the writer, 1 queued & 1 being written */
+#define WRITER_QUEUE_SIZE   2
+
 using namespace Eigen;
 
+/*
+ * projectCellNum()
+ * DESCRIPTION: estimate number of cells after refining the marked cells
+ * INPUT: cellNum - number of cells of the current mesh
+ *        markedNum - number of marked cells
+ *        growth - number of new cells per marked cell
+ * OUTPUT: none
+ * RETURN: estimated number of cells after refinement
+ */
+static size_t projectCellNum(size_t cellNum, size_t markedNum, double growth)
+{
+    return cellNum + (size_t)(markedNum * growth);
+}
+
 /*
  * FieldAdaptiveRefine()
  * DESCRIPTION: refine field according to the given density field
@@ -17,72 +49,263 @@ using namespace Eigen;
  *        C - 8xd matrix, each column is a cell of a mesh, each cells contains 8 indexes of 8 vertexes in V
  *            following vtk convention
  *        DensityField - scalar function of a 3D vector
- *        method - refine method, having two choices, padding or trivial method
- *        metric - density metric to evaluate the density of a hex cell, having two choices, len or vol metric
- *        iterNum - number of iteration
- *        smooth - whether smooth after each padding - no use for trivial refine
- *        mark - whether output mesh with padded element marked after each padding - no use for trivial refine
- *        eval - whether evaluate the result mesh and output actual field, referece field and difference field
- * OUTPUT: field adaptive refined mesh
+ *        options - refine method, density metric, number of iterations, marking, snapshots & outputs,
+ *                  with stop criteria, refinement stops when either is hit, the deadline only gates starting
+ *                  an iteration, an iteration is not started if it is predicted to overrun the deadline,
+ *                  a running iteration is never interrupted and the first iteration has no prediction,
+ *                  so it only waits for a deadline already passed, the mesh of lowest relative L2 density error
+ *                  so far is returned, it is written into options.bestFile before an iteration refines it
+ *                  and read back if it is returned, so it is never copied in memory
+ *        history - history of trivial refinements of V, C kept between calls, no coarsening if null,
+ *                  replaced cells resolved by the density field are restored before refinement
+ * OUTPUT: field adaptive refined mesh, updated history
  * RETURN: 0 if success, -1 if failed
  */
 int FieldAdaptiveRefine(
     Matrix3Xd &V,
     MatrixXi &C,
     const std::function<double(Vector3d)> &DensityField,
-    RefineMethod method,
-    HexEval::DensityMetric metric,
-    int iterNum,
-    bool smooth,
-    bool mark,
-    bool eval)
+    const RefineOptions &options,
+    RefineHistory *history)
 {
+    const RefineMethod method = options.method;
+    const HexEval::DensityMetric metric = options.metric;
+    const StopCriteria &stop = options.stop;
+    const MarkBudget *budget = options.budget;
+    const char *checkpoint = options.checkpoint;
+
     int IterCount = 0;
     std::queue<int> TargetC;
+    std::vector<int> CellOrigin;
+    RefineTree tree;
+    std::vector<HexCell> coarseC;
     std::vector<double> HexDensity;
     std::vector<double> RefDensity;
+    std::vector<char> Active;
     HexEval::HexEvaluator evaluator;
+    HexEval::QualityReport report;
+    HexEval::ErrorReport errorReport;
+    HexMesh mesh;
+    AsyncWriter writer(WRITER_QUEUE_SIZE);
+
+    typedef std::chrono::steady_clock Clock;
+    const Clock::time_point startTime = Clock::now();
+    double lastIterTime = 0;
+    size_t lastCellNum = 0;
+    double lastError = 0;
+    double bestError = 0;
+    int bestIter = 0;
+    bool bestIsCurrent = true;
+    const bool keepBest = stop.minImprovement > 0 || stop.deadline > 0;
+    bool bestWritten = false;
+    size_t bestLevelNum = 0;
+    std::vector<int> bestCellId;
+    double growth = (method == TRIVIAL_REFINE) ? TRIVIAL_CELL_GROWTH : PADDING_CELL_GROWTH;
 
-    /* evaluate hex density */
-    std::cout << "\nEvaluate Hex Density..." << std::endl;
-    evaluator.EvalDensityField(V, C, metric);
     evaluator.setRefDensityField(DensityField);
-    HexDensity = evaluator.GetDensityField();
-    RefDensity = evaluator.GetRefDensityField(V, C);
+
+    if (history != NULL && method != TRIVIAL_REFINE)
+    {
+        std::cout << "coarsening is only supported by trivial refine method, ignored." << std::endl;
+        history = NULL;
+    }
+
+    if (options.resume)
+    {
+        /* restore mesh, densities, marked state and iteration counter from the snapshot */
+        int snapMetric;
+        std::cout << "\nResume from " << checkpoint << "..." << std::endl;
+        if (readCheckpoint(checkpoint, IterCount, snapMetric, mesh, HexDensity, RefDensity, Active) == -1)
+            return -1;
+        if (snapMetric != metric)
+        {
+            std::cout << "density metric of the snapshot does not match." << std::endl;
+            return -1;
+        }
+        evaluator.setDensityField(HexDensity);
+        std::cout << "Resumed after iteration " << IterCount << ", " << mesh.C.size() << " cells" << std::endl;
+        if (history != NULL)
+            history->init(mesh.C.size());
+    }
+    else
+    {
+        /* set mesh from C, V, refinement and evaluation then work on the mesh in place */
+        mesh.V.resize(V.cols());
+        for (int i = 0; i < V.cols(); i++)
+            mesh.V.at(i) = V.col(i);
+
+        mesh.C.resize(C.cols());
+        for (int i = 0; i < C.cols(); i++)
+            for (int j = 0; j < HEX_SIZE; j++)
+                mesh.C.at(i).at(j) = C(j, i);
+
+        /* restore replaced cells no longer demanded by the density field */
+        if (history != NULL && history->CellId.size() != mesh.C.size())
+            history->init(mesh.C.size());
+        if (history != NULL && !history->levels.empty())
+        {
+            std::cout << "\nCoarsen Hex Mesh..." << std::endl;
+            if (CoarsenTargetHex(mesh, *history, DensityField, metric, budget ? budget->unmarkTolerance : 0) == -1)
+                return -1;
+        }
+
+        /* evaluate hex density */
+        std::cout << "\nEvaluate Hex Density..." << std::endl;
+        evaluator.EvalDensityField(mesh.getV(), mesh.getC(), metric);
+        HexDensity = evaluator.GetDensityField();
+        RefDensity = evaluator.GetRefDensityField(mesh.getV(), mesh.getC());
+    }
 
     /* according to hex density and reference field, mark target hex cells */
     std::cout << "Mark Target Cells..." << std::endl;
-    if (MarkTargetHex(V, C, TargetC, RefDensity, HexDensity) == -1)
+    if ((budget ? RankedMarkTargetHex(mesh.getC(), TargetC, RefDensity, HexDensity, method, *budget, Active)
+                : MarkTargetHex(mesh.getV(), mesh.getC(), TargetC, RefDensity, HexDensity)) == -1)
         return -1;
 
-    while ((!TargetC.empty()) && (IterCount++ < iterNum))
+    HexEval::EvalDensityError(HexDensity, RefDensity, errorReport);
+    lastError = errorReport.relL2;
+    std::cout << "Relative L2 density error: " << lastError << std::endl;
+    bestError = lastError;
+    bestIter = IterCount;
+
+    while ((!TargetC.empty()) && (IterCount++ < options.iterNum))
     {
+        /* do not start an iteration predicted to overrun the deadline */
+        const size_t markedNum = TargetC.size(), oldCellNum = mesh.C.size();
+        const size_t projectedNum = projectCellNum(oldCellNum, markedNum, growth);
+        const double elapsed = std::chrono::duration<double>(Clock::now() - startTime).count();
+        if (stop.deadline > 0)
+        {
+            const double predicted = lastCellNum ? lastIterTime * projectedNum / lastCellNum : 0;
+            if (elapsed + predicted > stop.deadline)
+            {
+                std::cout << "Deadline reached: elapsed " << elapsed << "s, next iteration predicted " << predicted << "s" << std::endl;
+                break;
+            }
+        }
+        const Clock::time_point iterStartTime = Clock::now();
+
+        /* write the best mesh so far before refining it in place, history is rolled back by dropping later levels */
+        if (keepBest && bestIsCurrent)
+        {
+            if (writeCheckpoint(options.bestFile, IterCount - 1, metric, mesh, HexDensity, RefDensity, Active) == -1)
+                return -1;
+            if (history != NULL)
+            {
+                bestLevelNum = history->levels.size();
+                bestCellId = history->CellId;
+            }
+            bestWritten = true;
+            bestIsCurrent = false;
+        }
+
         /* refine according to target hex cells */
         std::cout << "Refine Hex Mesh..." << std::endl;
         std::cout << "Iterations:" << IterCount-1 << "\n" << std::endl;
-        if (RefineTargetHex(V, C, TargetC, method, smooth, mark) == -1)
+        if (history != NULL)
+            coarseC = mesh.C;
+        if (RefineTargetHex(mesh, TargetC, CellOrigin, tree, method, options.smooth, options.mark, &writer) == -1)
             return -1;
+        if (history != NULL)
+            history->record(tree, CellOrigin, coarseC);
 
-        /* evaluate hex density */
+        /* new or modified cells come from marked cells, so they are in the marked state */
+        if (budget != NULL)
+        {
+            std::vector<char> OldActive;
+            OldActive.swap(Active);
+            Active.resize(mesh.C.size());
+            for (size_t i = 0; i < mesh.C.size(); i++)
+                Active.at(i) = (CellOrigin.at(i) == -1) ? true : OldActive.at(CellOrigin.at(i));
+        }
+
+        /* evaluate hex quality */
+        if (options.quality)
+        {
+            std::cout << "Evaluate Hex Quality..." << std::endl;
+            HexEval::EvalQuality(mesh.getV(), mesh.getC(), report);
+            HexEval::PrintQualityReport(report, std::cout);
+        }
+
+        /* evaluate hex density of new or modified cells, reuse the others */
         std::cout << "Evaluate Hex Density..." << std::endl;
-        evaluator.EvalDensityField(V, C, metric);
-        evaluator.setRefDensityField(DensityField);
+        std::cout << "Dirty cells: " << std::count(CellOrigin.begin(), CellOrigin.end(), -1) << "/" << mesh.C.size() << std::endl;
+        if (evaluator.UpdateDensityField(mesh.getV(), mesh.getC(), metric, CellOrigin) == -1)
+            return -1;
+        evaluator.UpdateRefDensityField(mesh.getV(), mesh.getC(), CellOrigin, RefDensity);
         HexDensity = evaluator.GetDensityField();
-        RefDensity = evaluator.GetRefDensityField(V, C);
 
         /* according to hex density and reference field, mark target hex cells */
         std::cout << "Mark Target Cells..." << std::endl;
-        if (MarkTargetHex(V, C, TargetC, RefDensity, HexDensity) == -1)
+        if ((budget ? RankedMarkTargetHex(mesh.getC(), TargetC, RefDensity, HexDensity, method, *budget, Active)
+                    : MarkTargetHex(mesh.getV(), mesh.getC(), TargetC, RefDensity, HexDensity)) == -1)
+            return -1;
+
+        /* write snapshot */
+        if (checkpoint != NULL)
+        {
+            std::cout << "Write Snapshot..." << std::endl;
+            if (writeCheckpoint(checkpoint, IterCount, metric, mesh, HexDensity, RefDensity, Active) == -1)
+                return -1;
+        }
+
+        /* report progress, growth of the next iteration is estimated from this one */
+        growth = (double)(mesh.C.size() - oldCellNum) / markedNum;
+        const double iterTime = std::chrono::duration<double>(Clock::now() - iterStartTime).count();
+        HexEval::EvalDensityError(HexDensity, RefDensity, errorReport);
+        std::cout << "Iteration " << IterCount << ": " << mesh.C.size() << " cells, "
+                  << iterTime << "s, elapsed " << std::chrono::duration<double>(Clock::now() - startTime).count() << "s, "
+                  << "relative L2 density error " << errorReport.relL2 << ", "
+                  << "projected cells of next iteration " << projectCellNum(mesh.C.size(), TargetC.size(), growth) << std::endl;
+        lastIterTime = iterTime;
+        lastCellNum = mesh.C.size();
+
+        /* stop if error does not improve enough */
+        const double improvement = (lastError > 0) ? (lastError - errorReport.relL2) / lastError : 0;
+        lastError = errorReport.relL2;
+        if (errorReport.relL2 < bestError)
+        {
+            bestError = errorReport.relL2;
+            bestIter = IterCount;
+            bestIsCurrent = true;
+        }
+        if (stop.minImprovement > 0 && improvement < stop.minImprovement)
+        {
+            std::cout << "Converged: error improvement " << improvement << " is below " << stop.minImprovement << std::endl;
+            break;
+        }
+    }
+
+    /* an iteration raising the error is not kept */
+    if (keepBest && !bestIsCurrent)
+    {
+        int snapIter, snapMetric;
+        std::cout << "Return the mesh of iteration " << bestIter << ", relative L2 density error " << bestError << std::endl;
+        if (readCheckpoint(options.bestFile, snapIter, snapMetric, mesh, HexDensity, RefDensity, Active) == -1)
             return -1;
+        if (history != NULL)
+        {
+            history->levels.resize(bestLevelNum);
+            history->CellId.swap(bestCellId);
+        }
     }
+    if (bestWritten)
+        std::remove(options.bestFile);
 
     std::cout << "Refinement Finished!\n" << std::endl;
 
+    /* wait for pending outputs */
+    writer.flush();
+
+    /* set C & V from mesh */
+    V = mesh.getV();
+    C = mesh.getC();
+
     /* evaluate result hex */
-    if (eval)
+    if (options.eval)
     {
         std::cout << "Evaluate Result Hex..." << std::endl;
-        if (EvalFieldAdaptiveMesh(V, C, DensityField, metric) == -1)
+        if (EvalFieldAdaptiveMesh(V, C, HexDensity, RefDensity, options.fields, options.errorFile) == -1)
             return -1;
     }
     std::cout << "Final Evaluation Finished!\n" << std::endl;
@@ -100,11 +323,10 @@ int FieldAdaptiveRefine(
  * OUTPUT: TargetC  -indexes of target cells
  * RETURN: 0 if success, -1 if failed
  */
-int MarkTargetHex(const Matrix3Xd &V, const MatrixXi &C, std::queue<int> &TargetC, std::vector<double> &RefDensity, std::vector<double> &HexDensity)
+int MarkTargetHex(const Ref<const Matrix3Xd> &V, const Ref<const MatrixXi> &C, std::queue<int> &TargetC, std::vector<double> &RefDensity, std::vector<double> &HexDensity)
 {
     for (int i = 0; i < C.cols(); i++)
     {
-        MatrixXi c = C.col(i);
         if (RefDensity.at(i) > HexDensity.at(i))
         {
             TargetC.push(i);
@@ -113,30 +335,150 @@ int MarkTargetHex(const Matrix3Xd &V, const MatrixXi &C, std::queue<int> &Target
     return 0;
 }
 
+/*
+ * RankedMarkTargetHex()
+ * DESCRIPTION: mark target hex cells ranked by relative density error, i.e. (reference - density) / reference
+ *              with hysteresis of two tolerances, a cell enters the marked state if its relative error is beyond
+ *              the tolerance, and leaves it only when its error is within the lower unmark tolerance, so cells
+ *              close to the reference field are not refined again and again
+ *              at most the top maxCellNum cells of the marked state are marked, and the number of marked cells
+ *              is further limited so that the estimated peak memory of the refinement stays within maxMemory
+ * INPUT: C - 8xd matrix, each column is a cell of a mesh, each cells contains 8 indexes of 8 vertexes in V
+ *            following vtk convention
+ *        RefDensity - reference density field
+ *        HexDensity - density of each element
+ *        method - refine method, used to estimate growth of the mesh
+ *        budget - tolerances, cell number budget and memory budget
+ *        Active - whether each cell is in the marked state, empty if none is
+ * OUTPUT: TargetC - indexes of target cells, ordered by index
+ *         Active - updated marked state of each cell, including cells left out by budgets
+ * RETURN: 0 if success, -1 if failed
+ */
+int RankedMarkTargetHex(const Ref<const MatrixXi> &C, std::queue<int> &TargetC, std::vector<double> &RefDensity, std::vector<double> &HexDensity, RefineMethod method, const MarkBudget &budget, std::vector<char> &Active)
+{
+    const size_t cnum = C.cols();
+    if (RefDensity.size() < cnum || HexDensity.size() < cnum)
+        return -1;
+    if (Active.size() != cnum)
+        Active.assign(cnum, false);
+
+    /* collect under-resolved cells in the marked state */
+    std::vector<std::pair<double, int>> candidates;
+    for (size_t i = 0; i < cnum; i++)
+    {
+        const double ref = RefDensity[i];
+        const double relErr = (ref > 0) ? (ref - HexDensity[i]) / ref : 1;
+        Active[i] = (ref > HexDensity[i]) && relErr > (Active[i] ? budget.unmarkTolerance : budget.tolerance);
+        if (Active[i])
+            candidates.emplace_back(relErr, i);
+    }
+
+    /* number of cells allowed by budgets */
+    const size_t candidateNum = candidates.size();
+    size_t maxNum = candidateNum;
+    if (budget.maxCellNum > 0)
+        maxNum = std::min(maxNum, (size_t)budget.maxCellNum);
+    if (budget.maxMemory > 0)
+    {
+        const double cellBudget = budget.maxMemory * 1024 * 1024 / CELL_MEMORY_BYTES - (double)cnum;
+        const int growth = (method == TRIVIAL_REFINE) ? TRIVIAL_CELL_GROWTH : PADDING_CELL_GROWTH;
+        maxNum = std::min(maxNum, (size_t)std::max(0.0, cellBudget / growth));
+    }
+
+    /* partial selection of cells with the largest relative error */
+    if (maxNum < candidateNum)
+    {
+        std::nth_element(candidates.begin(), candidates.begin() + maxNum, candidates.end(),
+                         std::greater<std::pair<double, int>>());
+        candidates.resize(maxNum);
+    }
+
+    std::vector<int> marked(candidates.size());
+    for (size_t i = 0; i < candidates.size(); i++)
+        marked[i] = candidates[i].second;
+    std::sort(marked.begin(), marked.end());
+    for (int cIdx : marked)
+        TargetC.push(cIdx);
+
+    std::cout << "Marked " << marked.size() << " cells out of " << candidateNum << " candidates" << std::endl;
+    return 0;
+}
+
+/*
+ * CoarsenTargetHex()
+ * DESCRIPTION: restore cells replaced by trivial refinement where the density field no longer demands resolution,
+ *              i.e. a replaced cell would not be marked, from the latest refinement to the earliest
+ * INPUT: mesh - hex mesh to be coarsened in place
+ *        history - history of trivial refinements of the mesh
+ *        DensityField - scalar function of a 3D vector
+ *        metric - density metric to evaluate the density of a hex cell, having two choices, len or vol metric
+ *        tolerance - tolerance of relative density error of a replaced cell
+ * OUTPUT: coarsened mesh, updated history
+ * RETURN: 0 if success, -1 if failed
+ */
+int CoarsenTargetHex(HexMesh &mesh, RefineHistory &history, const std::function<double(Vector3d)> &DensityField, HexEval::DensityMetric metric, double tolerance)
+{
+    HexEval::HexEvaluator evaluator;
+    const size_t oldCellNum = mesh.C.size();
+    int restoreNum = 0;
+
+    evaluator.setRefDensityField(DensityField);
+
+    /* cells restored from a later refinement may complete components of an earlier one */
+    for (int level = history.levels.size() - 1; level >= 0; level--)
+    {
+        std::vector<int> candidates;
+        history.getCandidates(mesh, level, candidates);
+        if (candidates.empty())
+            continue;
+
+        /* evaluate replaced cells as if they were restored */
+        MatrixXi ParentC(HEX_SIZE, candidates.size());
+        for (size_t k = 0; k < candidates.size(); k++)
+            for (int j = 0; j < HEX_SIZE; j++)
+                ParentC(j, k) = history.levels.at(level).ParentC.at(candidates.at(k)).at(j);
+
+        if (evaluator.EvalDensityField(mesh.getV(), ParentC, metric) == -1)
+            return -1;
+        std::vector<double> Density = evaluator.GetDensityField();
+        std::vector<double> RefDensity = evaluator.GetRefDensityField(mesh.getV(), ParentC);
+
+        std::vector<bool> resolved(candidates.size());
+        for (size_t k = 0; k < candidates.size(); k++)
+            resolved.at(k) = RefDensity.at(k) - Density.at(k) <= tolerance * RefDensity.at(k);
+
+        restoreNum += history.coarsen(mesh, level, candidates, resolved);
+    }
+
+    std::cout << "Restored " << restoreNum << " cells, " << oldCellNum << " -> " << mesh.C.size() << " cells" << std::endl;
+    return 0;
+}
+
 /*
  * RefineTargetHex()
  * DESCRIPTION: refine target hex cells of the given mesh
- * INPUT: V - 3xd matrix, each column is a vertex of a mesh
- *        C - 8xd matrix, each column is a cell of a mesh, each cells contains 8 indexes of 8 vertexes in V
- *            following vtk convention
+ * INPUT: mesh - hex mesh to be refined in place
  *        TargetC - indexes of target hex cell
  *        method - refine method, having two choices, padding or trivial method
  *        smooth - whether smooth after each padding - no use for trivial refine
  *        mark - whether output mesh with padded element marked after each padding - no use for trivial refine
- * OUTPUT: refined mesh (represented by V, C)
+ *        writer - background writer of marked meshes, write synchronously if null
+ * OUTPUT: refined mesh
+ *         CellOrigin - index of each cell before refinement, -1 if the cell is new or modified
+ *         tree - parent-children map of cells of this refinement
  *         vtk mesh file with padded element marked after each padding if padding method is used and mark flag is active
  * RETURN: 0 if success, -1 if failed
  */
-int RefineTargetHex(Matrix3Xd &V, MatrixXi &C, std::queue<int> &TargetC, RefineMethod method, bool smooth, bool mark)
+int RefineTargetHex(HexMesh &mesh, std::queue<int> &TargetC, std::vector<int> &CellOrigin, RefineTree &tree, RefineMethod method, bool smooth, bool mark, AsyncWriter *writer)
 {
     switch (method)
     {
     case TRIVIAL_REFINE:
-        if (TrivialRefine(V, C, TargetC) == -1)
+        if (TrivialRefine(mesh, TargetC, CellOrigin, tree) == -1)
             return -1;
         break;
     case PADDING_REFINE:
-        if (PaddingRefine(V, C, TargetC, smooth, mark) == -1)
+        if (PaddingRefine(mesh, TargetC, CellOrigin, tree, smooth, mark, writer) == -1)
             return -1;
         break;
     default:
@@ -148,58 +490,60 @@ int RefineTargetHex(Matrix3Xd &V, MatrixXi &C, std::queue<int> &TargetC, RefineM
 
 /*
  * TrivialRefine()
- * DESCRIPTION: refine target hex cells of the given mesh using trivial method
- * INPUT: V - 3xd matrix, each column is a vertex of a mesh
- *        C - 8xd matrix, each column is a cell of a mesh, each cells contains 8 indexes of 8 vertexes in V
- *            following vtk convention
+ * DESCRIPTION: refine target hex cells of the given mesh using trivial method, all vertexes of target cells are selected
+ * INPUT: mesh - hex mesh to be refined in place
  *        TargetC - indexes of target hex cell
- * OUTPUT: refined mesh (represented by V, C)
+ * OUTPUT: refined mesh
+ *         CellOrigin - index of each cell before refinement, -1 if the cell is new
+ *         tree - parent-children map of cells, a refined cell is the parent of the cells of its template
  * RETURN: 0 if success, -1 if failed
  */
-int TrivialRefine(Matrix3Xd &V, MatrixXi &C, std::queue<int> &TargetC)
+int TrivialRefine(HexMesh &mesh, std::queue<int> &TargetC, std::vector<int> &CellOrigin, RefineTree &tree)
 {
-    HexRefine::Mesh mesh = HexRefine::Mesh();
     std::vector<size_t> TargetV;
 
-    /* set mesh from C, V */
-    for (int i = 0; i < V.cols(); i++)
-        mesh.V.push_back(V.col(i));
-
-    for (int i = 0; i < C.cols(); i++)
-    {
-        HexRefine::Cell c;
-        for (int j = 0; j < HEX_SIZE; j++)
-        {
-            c.push_back(C(j, i));
-        }
-        mesh.C.push_back(c);
-    }
-
     while (!TargetC.empty())
     {
         for (int i = 0; i < HEX_SIZE; i++)
-            TargetV.push_back(C(i, TargetC.front()));
+            TargetV.push_back(mesh.C.at(TargetC.front()).at(i));
         TargetC.pop();
     }
 
-    /* refine */
-    mesh.getVI_CI();
-    mesh.refine(TargetV);
+    return TrivialRefine(mesh, TargetV, CellOrigin, tree);
+}
 
-    /* set C & V from mesh */
-    C.resize(HEX_SIZE, mesh.C.size());
-    V.resize(3, mesh.V.size());
+/*
+ * TrivialRefine()
+ * DESCRIPTION: refine the given mesh around selected vertexes using trivial method,
+ *              cells are replaced with templates of their selected vertexes after the selection is made standard
+ *              vertexes and cells are swapped into the refine engine and back without copy
+ * INPUT: mesh - hex mesh to be refined in place
+ *        TargetV - indexes of selected vertexes
+ * OUTPUT: refined mesh
+ *         CellOrigin - index of each cell before refinement, -1 if the cell is new
+ *         tree - parent-children map of cells, a refined cell is the parent of the cells of its template
+ * RETURN: 0 if success, -1 if failed
+ */
+int TrivialRefine(HexMesh &mesh, std::vector<size_t> &TargetV, std::vector<int> &CellOrigin, RefineTree &tree)
+{
+    HexRefine::Mesh refineMesh = HexRefine::Mesh();
 
-    for (size_t i = 0; i < mesh.V.size(); i++)
-        V.col(i) = mesh.V.at(i);
+    /* set refine mesh from mesh */
+    refineMesh.V.swap(mesh.V);
+    refineMesh.C.swap(mesh.C);
 
-    for (size_t i = 0; i < mesh.C.size(); i++)
-    {
-        for (size_t j = 0; j < HEX_SIZE; j++)
-        {
-            C(j, i) = mesh.C.at(i).at(j);
-        }
-    }
+    /* refine */
+    refineMesh.getVI_CI();
+    refineMesh.refine(TargetV);
+
+    /* set mesh from refine mesh */
+    mesh.V.swap(refineMesh.V);
+    mesh.C.swap(refineMesh.C);
+
+    /* existing vertexes are never moved by trivial refinement, only new cells are dirty */
+    CellOrigin.swap(refineMesh.CellOrigin);
+    tree.ChildOffset.swap(refineMesh.ChildOffset);
+    tree.ChildC.swap(refineMesh.ChildC);
 
     return 0;
 }
@@ -207,36 +551,25 @@ int TrivialRefine(Matrix3Xd &V, MatrixXi &C, std::queue<int> &TargetC)
 /*
  * PaddingRefine()
  * DESCRIPTION: refine target hex cells of the given mesh using padding method
- * INPUT: V - 3xd matrix, each column is a vertex of a mesh
- *        C - 8xd matrix, each column is a cell of a mesh, each cells contains 8 indexes of 8 vertexes in V
- *            following vtk convention
+ *              vertexes and cells are swapped into the padding engine and back without copy
+ * INPUT: mesh - hex mesh to be refined in place
  *        TargetC - indexes of target hex cell
  *        smooth - whether smooth after each padding
  *        mark - whether output mesh with padded element marked after each padding
- * OUTPUT: refined mesh (represented by V, C)
+ *        writer - background writer of marked meshes, write synchronously if null
+ * OUTPUT: refined mesh
+ *         CellOrigin - index of each cell before refinement, -1 if the cell is new, modified or has moved vertexes
+ *         tree - parent-children map of cells, a marked cell is the parent of itself and cells padded on its faces
  *         vtk mesh file with padded element marked after each padding if mark flag is active
  * RETURN: 0 if success, -1 if failed
  */
-int PaddingRefine(Matrix3Xd &V, MatrixXi &C, std::queue<int> &TargetC, bool smooth, bool mark)
+int PaddingRefine(HexMesh &mesh, std::queue<int> &TargetC, std::vector<int> &CellOrigin, RefineTree &tree, bool smooth, bool mark, AsyncWriter *writer)
 {
     static int PadNum = 1;
 
-    HexPadding::Mesh mesh = HexPadding::Mesh();
+    HexPadding::Mesh padMesh = HexPadding::Mesh();
     std::vector<size_t> markedC;
-
-    /* set mesh from C, V */
-    for (int i = 0; i < V.cols(); i++)
-        mesh.V.push_back(V.col(i));
-
-    for (int i = 0; i < C.cols(); i++)
-    {
-        HexPadding::Cell c;
-        for (int j = 0; j < HEX_SIZE; j++)
-        {
-            c.push_back(C(j, i));
-        }
-        mesh.C.push_back(c);
-    }
+    const size_t oldCNum = mesh.C.size();
 
     while (!TargetC.empty())
     {
@@ -244,32 +577,57 @@ int PaddingRefine(Matrix3Xd &V, MatrixXi &C, std::queue<int> &TargetC, bool smoo
         TargetC.pop();
     }
 
+    /* set padding mesh from mesh */
+    padMesh.V.swap(mesh.V);
+    padMesh.C.swap(mesh.C);
+
     /* refine */
-    HexPadding::padding(mesh, markedC, smooth, mark);
+    HexPadding::padding(padMesh, markedC, smooth, mark);
+
+    /* set mesh from padding mesh */
+    mesh.V.swap(padMesh.V);
+    mesh.C.swap(padMesh.C);
 
-    /* set C, V from mesh */
-    C.resize(HEX_SIZE, mesh.C.size());
-    V.resize(3, mesh.V.size());
+    tree.ChildOffset.swap(padMesh.ChildOffset);
+    tree.ChildC.swap(padMesh.ChildC);
 
-    for (size_t i = 0; i < mesh.V.size(); i++)
-        V.col(i) = mesh.V.at(i);
+    /* padding keeps indexes of existing cells, new cells are appended */
+    std::vector<bool> movedV(mesh.V.size(), false);
+    for (size_t vIdx : padMesh.ModifiedV)
+        movedV.at(vIdx) = true;
 
+    CellOrigin.resize(mesh.C.size());
     for (size_t i = 0; i < mesh.C.size(); i++)
     {
-        for (size_t j = 0; j < HEX_SIZE; j++)
-        {
-            C(j, i) = mesh.C.at(i).at(j);
-        }
+        CellOrigin.at(i) = (i < oldCNum) ? (int)i : -1;
+        for (size_t j = 0; j < HEX_SIZE && CellOrigin.at(i) != -1; j++)
+            if (movedV.at(mesh.C.at(i).at(j)))
+                CellOrigin.at(i) = -1;
     }
+    for (size_t cIdx : padMesh.ModifiedC)
+        CellOrigin.at(cIdx) = -1;
 
     /* output mesh with marked elements */
     if (mark)
     {
         std::string outName = std::to_string(PadNum++) + "times_paded.vtk";
         std::vector<int> PaddedFlag(mesh.C.size(), 0);
-        for (size_t cIdx : mesh.PaddedC)
+        for (size_t cIdx : padMesh.PaddedC)
             PaddedFlag.at(cIdx) = 1;
-        vtkWriter(outName.c_str(), V, C, PaddedFlag);
+
+        if (writer == NULL)
+        {
+            CacheArray padded = {"padded", CACHE_CELL_DATA, CACHE_INT32, 1, PaddedFlag.data()};
+            vtkWriter(outName.c_str(), mesh.getV(), mesh.getC(), std::vector<CacheArray>(1, padded));
+        }
+        else
+        {
+            /* the mesh is modified by the next iteration, hand a snapshot to the writer */
+            writer->push([outName, SnapV = Matrix3Xd(mesh.getV()), SnapC = MatrixXi(mesh.getC()), PaddedFlag = std::move(PaddedFlag)]()
+                         {
+                CacheArray padded = {"padded", CACHE_CELL_DATA, CACHE_INT32, 1, PaddedFlag.data()};
+                vtkWriter(outName.c_str(), SnapV, SnapC, std::vector<CacheArray>(1, padded)); });
+        }
     }
 
     return 0;
@@ -277,25 +635,48 @@ int PaddingRefine(Matrix3Xd &V, MatrixXi &C, std::queue<int> &TargetC, bool smoo
 
 /*
  * EvalFieldAdaptiveMesh()
- * DESCRIPTION: evaluate the density of result mesh
+ * DESCRIPTION: evaluate the density error of result mesh from the fields kept by the refinement, nothing is evaluated again
  * INPUT: V - 3xd matrix, each column is a vertex of a mesh
  *        C - 8xd matrix, each column is a cell of a mesh, each cells contains 8 indexes of 8 vertexes in V
  *            following vtk convention
- *        DensityField - indexes of target hex cell
- *        metric - density metric to evaluate the density of a hex cell, having two choices, len or vol metric
- * OUTPUT: vtk files of meshes with actual field, reference field and difference field
+ *        HexDensity - density of each cell
+ *        RefDensity - reference density of each cell
+ *        fields - whether output vtk file of actual field, reference field and difference field
+ *        errorFile - json file of the density error summary
+ * OUTPUT: density error summary in text and json
+ *         Field.vtk, the mesh with cell arrays density, reference & difference if fields flag is active
  * RETURN: 0 if success, -1 if failed
  */
-int EvalFieldAdaptiveMesh(const Matrix3Xd &V, const MatrixXi &C, const std::function<double(Vector3d)> &DensityField, HexEval::DensityMetric metric)
+int EvalFieldAdaptiveMesh(const Ref<const Matrix3Xd> &V, const Ref<const MatrixXi> &C, const std::vector<double> &HexDensity, const std::vector<double> &RefDensity, bool fields, const char *errorFile)
 {
-    HexEval::HexEvaluator evaluator;
-    evaluator.setRefDensityField(DensityField);
+    if (HexDensity.size() != (size_t)C.cols() || RefDensity.size() != (size_t)C.cols())
+        return -1;
+
+    /* report error statistics */
+    HexEval::ErrorReport report;
+    HexEval::EvalDensityError(HexDensity, RefDensity, report);
+    HexEval::PrintErrorReport(report, std::cout);
 
-    if (evaluator.EvalDensityField(V, C, metric) == -1)
+    std::ofstream json(errorFile);
+    if (!json)
+    {
+        std::cout << "cannot open file " << errorFile << std::endl;
         return -1;
+    }
+    HexEval::PrintErrorReportJson(report, json);
 
-    vtkWriter("Field.vtk", V, C, evaluator.GetDensityField());
-    vtkWriter("RefField.vtk", V, C, evaluator.GetRefDensityField(V, C));
-    vtkWriter("DiffField.vtk", V, C, evaluator.GetDiffDensityField(V, C));
+    /* output per-cell fields, the mesh is written once */
+    if (fields)
+    {
+        std::vector<double> diffField(HexDensity.size());
+        for (size_t cIdx = 0; cIdx < HexDensity.size(); cIdx++)
+            diffField[cIdx] = HexDensity[cIdx] - RefDensity[cIdx];
+
+        std::vector<CacheArray> arrays = {
+            {"density", CACHE_CELL_DATA, CACHE_FLOAT64, 1, HexDensity.data()},
+            {"reference", CACHE_CELL_DATA, CACHE_FLOAT64, 1, RefDensity.data()},
+            {"difference", CACHE_CELL_DATA, CACHE_FLOAT64, 1, diffField.data()}};
+        vtkWriter("Field.vtk", V, C, arrays);
+    }
     return 0;
 }
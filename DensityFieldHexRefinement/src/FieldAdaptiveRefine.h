@@ -5,6 +5,9 @@
 #include <vector>
 #include <eigen3/Eigen/Eigen>
 
+#include "HexMesh.h"
+#include "AsyncWriter.h"
+#include "RefineHistory.h"
 #include "HexEval/HexEval.h"
 
 enum RefineMethod
@@ -13,22 +16,72 @@ enum RefineMethod
     PADDING_REFINE
 };
 
+/*
+ * MarkBudget
+ * DESCRIPTION: limits of ranked marking, see RankedMarkTargetHex()
+ */
+struct MarkBudget
+{
+    double tolerance;         // cells whose relative density error is within tolerance are not marked
+    double unmarkTolerance;   // cells in the marked state stay marked until their error is within this lower tolerance
+    int maxCellNum;   // maximum number of marked cells per iteration, 0 for no limit
+    double maxMemory; // estimated peak memory of the refinement in MB, 0 for no limit
+};
+
+/*
+ * StopCriteria
+ * DESCRIPTION: criteria to stop refinement before the number of iterations is reached
+ */
+struct StopCriteria
+{
+    double minImprovement; // stop if relative L2 density error improves less than this ratio in one iteration, 0 to disable
+    double deadline;       // wall-clock deadline in seconds, 0 for no deadline
+};
+
+/*
+ * RefineOptions
+ * DESCRIPTION: options of FieldAdaptiveRefine()
+ */
+struct RefineOptions
+{
+    RefineMethod method;           // padding or trivial method
+    HexEval::DensityMetric metric; // density metric to evaluate the density of a hex cell
+    int iterNum;                   // number of iterations, including the ones before a resumed snapshot
+    StopCriteria stop;             // criteria to stop before iterNum
+    const MarkBudget *budget;      // limits of ranked marking, mark all under-resolved cells if null
+    const char *checkpoint;        // snapshot written after each iteration, null for no snapshot
+    bool resume;                   // continue from the snapshot instead of V, C
+    const char *bestFile;          // snapshot of the best mesh so far, only written with stop criteria
+    bool smooth;                   // smooth after each padding, padding method only
+    bool mark;                     // output mesh with padded element marked after each padding, padding method only
+    bool quality;                  // report quality of the mesh after each iteration
+    bool eval;                     // evaluate the result mesh and report the density error
+    bool fields;                   // output actual, reference & difference field when evaluating
+    const char *errorFile;         // json file of the density error summary when evaluating
+};
+
 inline double EvalDensity(const Eigen::Matrix3Xd &V, const Eigen::VectorXi &c, const std::function<double(Eigen::Vector3d)> &DensityField);
 
 inline double EvalDensity(const std::vector<Eigen::Vector3d> V, const std::function<double(Eigen::Vector3d)> &DensityField);
 
-int FieldAdaptiveRefine(Eigen::Matrix3Xd &V, Eigen::MatrixXi &C, const std::function<double(Eigen::Vector3d)> &DensityField, RefineMethod method, HexEval::DensityMetric, int iterNum, bool smooth, bool mark, bool eval);
+int FieldAdaptiveRefine(Eigen::Matrix3Xd &V, Eigen::MatrixXi &C, const std::function<double(Eigen::Vector3d)> &DensityField, const RefineOptions &options, RefineHistory *history);
 
-int MarkTargetHex(const Eigen::Matrix3Xd &V, const Eigen::MatrixXi &C, std::queue<int> &TargetC, std::vector<double> &RefDensity, std::vector<double> &HexDensity);
+int MarkTargetHex(const Eigen::Ref<const Eigen::Matrix3Xd> &V, const Eigen::Ref<const Eigen::MatrixXi> &C, std::queue<int> &TargetC, std::vector<double> &RefDensity, std::vector<double> &HexDensity);
+
+int RankedMarkTargetHex(const Eigen::Ref<const Eigen::MatrixXi> &C, std::queue<int> &TargetC, std::vector<double> &RefDensity, std::vector<double> &HexDensity, RefineMethod method, const MarkBudget &budget, std::vector<char> &Active);
 
 int TrivialMark(const Eigen::Matrix3Xd &V, const Eigen::MatrixXi &C, std::queue<int> &TargetC, const std::function<double(Eigen::Vector3d)> &DensityField);
 
-int RefineTargetHex(Eigen::Matrix3Xd &V, Eigen::MatrixXi &C, std::queue<int> &TargetC, RefineMethod method, bool smooth, bool mark);
+int CoarsenTargetHex(HexMesh &mesh, RefineHistory &history, const std::function<double(Eigen::Vector3d)> &DensityField, HexEval::DensityMetric metric, double tolerance);
+
+int RefineTargetHex(HexMesh &mesh, std::queue<int> &TargetC, std::vector<int> &CellOrigin, RefineTree &tree, RefineMethod method, bool smooth, bool mark, AsyncWriter *writer = NULL);
+
+int TrivialRefine(HexMesh &mesh, std::queue<int> &TargetC, std::vector<int> &CellOrigin, RefineTree &tree);
 
-int TrivialRefine(Eigen::Matrix3Xd &V, Eigen::MatrixXi &C, std::queue<int> &TargetC);
+int TrivialRefine(HexMesh &mesh, std::vector<size_t> &TargetV, std::vector<int> &CellOrigin, RefineTree &tree);
 
-int PaddingRefine(Eigen::Matrix3Xd &V, Eigen::MatrixXi &C, std::queue<int> &TargetC, bool smooth, bool mark);
+int PaddingRefine(HexMesh &mesh, std::queue<int> &TargetC, std::vector<int> &CellOrigin, RefineTree &tree, bool smooth, bool mark, AsyncWriter *writer = NULL);
 
-int EvalFieldAdaptiveMesh(const Eigen::Matrix3Xd &V, const Eigen::MatrixXi &C, const std::function<double(Eigen::Vector3d)> &DensityField, HexEval::DensityMetric metric);
+int EvalFieldAdaptiveMesh(const Eigen::Ref<const Eigen::Matrix3Xd> &V, const Eigen::Ref<const Eigen::MatrixXi> &C, const std::vector<double> &HexDensity, const std::vector<double> &RefDensity, bool fields, const char *errorFile);
 
 #endif
\ No newline at end of file
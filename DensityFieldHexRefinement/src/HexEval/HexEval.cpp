@@ -1,9 +1,14 @@
 #include <iostream>
+#include <cstdint>
 #include "HexEval.h"
 #include "heIntegral.h"
 #include "heUtility.hpp"
+#include "heQuadrature.hpp"
+#include "heBatch.h"
 
 #define HEX_SIZE    8
+#define EDGE_METRIC_TOL         1e-6
+#define EDGE_METRIC_MAX_DEPTH   8
 
 using namespace HexEval;
 using namespace Eigen;
@@ -12,6 +17,51 @@ using namespace Eigen;
 Edge::Edge() {}
 Edge::Edge(size_t v1, size_t v2) : v1Idx(v1), v2Idx(v2) {}
 
+/*
+ * getUniqueEdges()
+ * DESCRIPTION: get flat list of unique edges of a hex mesh by sorting edge keys
+ * INPUT: C - 8xd matrix, each column is a cell of a mesh, each cells contains 8 indexes of 8 vertexes in V
+ *            following vtk convention
+ * OUTPUT: E - 2xd matrix, each column is an unique edge, E(0, i) < E(1, i)
+ *         CellE - 12xd matrix, index of 12 edges in E of each cell, following the order of HexEdge
+ * RETURN: none
+ */
+static void getUniqueEdges(const Ref<const MatrixXi> &C, Matrix2Xi &E, Matrix<int, 12, Dynamic> &CellE)
+{
+    const size_t slotNum = 12 * (size_t)C.cols();
+    std::vector<std::pair<uint64_t, size_t>> keys(slotNum);
+
+    /* key of an edge is (smaller vertex index, larger vertex index) */
+    for (int cIdx = 0; cIdx < C.cols(); cIdx++)
+    {
+        for (int i = 0; i < 12; i++)
+        {
+            uint64_t v1 = C(HexEdge[i][0], cIdx), v2 = C(HexEdge[i][1], cIdx);
+            if (v1 > v2)
+                std::swap(v1, v2);
+            keys[12 * (size_t)cIdx + i] = std::make_pair((v1 << 32) | v2, 12 * (size_t)cIdx + i);
+        }
+    }
+    std::sort(keys.begin(), keys.end());
+
+    /* assign edge index to each slot, repeated keys share the same edge */
+    std::vector<uint64_t> uniqueKeys;
+    CellE.resize(12, C.cols());
+    for (size_t i = 0; i < slotNum; i++)
+    {
+        if (i == 0 || keys[i].first != keys[i - 1].first)
+            uniqueKeys.push_back(keys[i].first);
+        CellE(keys[i].second % 12, keys[i].second / 12) = uniqueKeys.size() - 1;
+    }
+
+    E.resize(2, uniqueKeys.size());
+    for (size_t eIdx = 0; eIdx < uniqueKeys.size(); eIdx++)
+    {
+        E(0, eIdx) = uniqueKeys[eIdx] >> 32;
+        E(1, eIdx) = uniqueKeys[eIdx] & 0xFFFFFFFF;
+    }
+}
+
 /*
  * EvalDensityField()
  * DESCRIPTION: evaluate density field of a hex mesh. There are three types of metric
@@ -29,7 +79,7 @@ Edge::Edge(size_t v1, size_t v2) : v1Idx(v1), v2Idx(v2) {}
  * OUTPUT: densityfield in HexEvaluator
  * RETURN: 0 if success, 01 if failed
  */
-int HexEvaluator::EvalDensityField(const Matrix3Xd &V, const MatrixXi &C, DensityMetric metric)
+int HexEvaluator::EvalDensityField(const Ref<const Matrix3Xd> &V, const Ref<const MatrixXi> &C, DensityMetric metric)
 {
     if (C.rows() != HEX_SIZE)
         return -1;
@@ -71,12 +121,14 @@ int HexEvaluator::EvalDensityField(const Matrix3Xd &V, const MatrixXi &C, Densit
  * OUTPUT: densityfield in HexEvaluator
  * RETURN: none
  */
-void HexEvaluator::EvalVolDensity(const Matrix3Xd &V, const MatrixXi &C)
+void HexEvaluator::EvalVolDensity(const Ref<const Matrix3Xd> &V, const Ref<const MatrixXi> &C)
 {
-    DensityField.clear();
+    CellMetrics metrics;
+    EvalCellMetrics(V, C, CELL_VOLUME, metrics);
 
-    for (int cIdx = 0; cIdx < C.cols(); cIdx++)
-        DensityField.push_back(1 / HexVolume(V, C.col(cIdx)));
+    DensityField.swap(metrics.volume);
+    for (auto &vol : DensityField)
+        vol = 1 / vol;
 }
 
 /*
@@ -88,39 +140,15 @@ void HexEvaluator::EvalVolDensity(const Matrix3Xd &V, const MatrixXi &C)
  * OUTPUT: densityfield in HexEvaluator
  * RETURN: none
  */
-void HexEvaluator::EvalLenDensity(const Matrix3Xd &V, const MatrixXi &C)
+void HexEvaluator::EvalLenDensity(const Ref<const Matrix3Xd> &V, const Ref<const MatrixXi> &C)
 {
-    double edgeLen = 0;
-
-    DensityField.clear();
-    EdgeLenMap.clear();
-
-    /* record length of every edges */
-    for (int cIdx = 0; cIdx < C.cols(); cIdx++)
-    {
-        Edge e;
-        for (int i = 0; i < 12; i++)
-        {
-            e.v1Idx = C(HexEdge[i][0], cIdx);
-            e.v2Idx = C(HexEdge[i][1], cIdx);
-            if (EdgeLenMap.find(e) == EdgeLenMap.end())
-                EdgeLenMap[e] = (V.col(e.v1Idx) - V.col(e.v2Idx)).squaredNorm();
-        }
-    }
+    CellMetrics metrics;
+    EvalCellMetrics(V, C, CELL_EDGE_LENGTH, metrics);
 
     /* calculate reciprocal of average length of edges of a hex cell */
-    for (int cIdx = 0; cIdx < C.cols(); cIdx++)
-    {
-        Edge e;
-        edgeLen = 0;
-        for (int i = 0; i < 12; i++)
-        {
-            e.v1Idx = C(HexEdge[i][0], cIdx);
-            e.v2Idx = C(HexEdge[i][1], cIdx);
-            edgeLen += EdgeLenMap[e];
-        }
-        DensityField.push_back(12 / edgeLen);
-    }
+    DensityField.swap(metrics.sqrEdgeLength);
+    for (auto &edgeLen : DensityField)
+        edgeLen = 12 / edgeLen;
 }
 
 /*
@@ -132,89 +160,259 @@ void HexEvaluator::EvalLenDensity(const Matrix3Xd &V, const MatrixXi &C)
  * OUTPUT: densityfield in HexEvaluator
  * RETURN: none
  */
-void HexEvaluator::EvalAnisotropicDensity(const Matrix3Xd &V, const MatrixXi &C)
+void HexEvaluator::EvalAnisotropicDensity(const Ref<const Matrix3Xd> &V, const Ref<const MatrixXi> &C)
 {
-    double edgeLen = 0;
+    Matrix2Xi E;
+    Matrix<int, 12, Dynamic> CellE;
 
     DensityField.clear();
-    EdgeAnisotropicMetricMap.clear();
 
-    /* record anisotropic metric of every edges */
-    for (int cIdx = 0; cIdx < C.cols(); cIdx++)
+    /* get flat list of unique edges */
+    getUniqueEdges(C, E, CellE);
+    EdgeAnisotropicMetric.resize(E.cols());
+
+    /* integrate anisotropic metric along every edge */
+    #pragma omp parallel for schedule(dynamic, 256)
+    for (int eIdx = 0; eIdx < (int)E.cols(); eIdx++)
     {
-        Edge e;
-        for (int i = 0; i < 12; i++)
-        {
-            e.v1Idx = C(HexEdge[i][0], cIdx);
-            e.v2Idx = C(HexEdge[i][1], cIdx);
-            if (EdgeAnisotropicMetricMap.find(e) == EdgeAnisotropicMetricMap.end())
-            {
-                Vector3d v1 = V.col(e.v1Idx);
-                Vector3d v2 = V.col(e.v2Idx);
-                Vector3d dV = v2 - v1;
-                std::function<double(double)> metric = [&v1, &dV, this](double t)
-                { return sqrt((dV.transpose() * AnisotropicDensityField(v1 + dV * 5) * dV)); };
-                EdgeAnisotropicMetricMap[e] = integrateSimpson(0, 1, metric, 1000);
-            }
-        }
+        const Vector3d v1 = V.col(E(0, eIdx));
+        const Vector3d dV = V.col(E(1, eIdx)) - v1;
+        std::function<double(double)> metric = [&v1, &dV, this](double t)
+        { return sqrt((dV.transpose() * AnisotropicDensityField(v1 + dV * t) * dV)); };
+        EdgeAnisotropicMetric[eIdx] = integrateGaussLegendre(0, 1, metric, EDGE_METRIC_TOL, EDGE_METRIC_MAX_DEPTH);
     }
 
     /* calculate reciprocal of average metric of edges of a hex cell */
+    DensityField.resize(C.cols());
     for (int cIdx = 0; cIdx < C.cols(); cIdx++)
     {
-        Edge e;
-        edgeLen = 0;
+        double edgeLen = 0;
         for (int i = 0; i < 12; i++)
-        {
-            e.v1Idx = C(HexEdge[i][0], cIdx);
-            e.v2Idx = C(HexEdge[i][1], cIdx);
-            edgeLen += EdgeAnisotropicMetricMap[e];
-        }
-        DensityField.push_back(12 / edgeLen);
+            edgeLen += EdgeAnisotropicMetric[CellE(i, cIdx)];
+        DensityField[cIdx] = 12 / edgeLen;
     }
 }
 
 /*
  * GetRefDensityField()
- * DESCRIPTION: evaluate density of each cell of a mesh using reference field
- *              for each cell, evaluate the average of values of the reference field at 8 vertexes
+ * DESCRIPTION: evaluate density of each cell of a mesh using reference field, see EvalRefDensity()
  * INPUT: V - 3xd matrix, each column is a vertex of a mesh
  *        C - 8xd matrix, each column is a cell of a mesh, each cells contains 8 indexes of 8 vertexes in V
  *            following vtk convention
- * OUTPUT: reference density field in HexEvaluator
+ * OUTPUT: none
+ * RETURN: reference density field
+ */
+std::vector<double> HexEvaluator::GetRefDensityField(const Eigen::Ref<const Eigen::Matrix3Xd> &V, const Eigen::Ref<const Eigen::MatrixXi> &C)
+{
+    std::vector<double> refField(C.cols());
+
+    ForEachHexBatch(V, C, [&](const HexBatch &batch, int cBegin)
+                    { EvalRefDensity(batch, refField.data() + cBegin); });
+    return refField;
+}
+
+/*
+ * EvalRefDensity()
+ * DESCRIPTION: evaluate density of each cell of a batch using reference field
+ *              for each cell, evaluate the cell average of the reference field using 2^3 or 3^3 Gauss quadrature
+ *              through the trilinear map of the hex, i.e. integral of field * |J| over integral of |J|
+ *              positions and jacobians of all quadrature points of the batch are evaluated by matrix products
+ *              using CORNER_AVERAGE_RULE, evaluate the average of values of the reference field at 8 vertexes
+ * INPUT: batch - batch of hex cells
+ * OUTPUT: refDensity - reference density of each cell of the batch
  * RETURN: none
  */
-std::vector<double> HexEvaluator::GetRefDensityField(const Eigen::Matrix3Xd &V, const Eigen::MatrixXi &C)
+void HexEvaluator::EvalRefDensity(const HexBatch &batch, double *refDensity) const
 {
-    std::vector<double> refField;
-    for (int cIdx = 0; cIdx < C.cols(); cIdx++)
+    const int bsize = batch.size;
+
+    if (RefRule == CORNER_AVERAGE_RULE)
     {
-        MatrixXi c = C.col(cIdx);
-        refField.push_back(EvalDensity(V, c, RefDensityField));
+        for (int b = 0; b < bsize; b++)
+        {
+            double sum = 0;
+            for (int i = 0; i < HEX_SIZE; i++)
+                sum += RefDensityField(Vector3d(batch.Px(i, b), batch.Py(i, b), batch.Pz(i, b)));
+            refDensity[b] = sum * 0.125;
+        }
+        return;
     }
-    return refField;
+
+    const HexQuadrature &quad = GetHexQuadrature(RefRule == GAUSS_3_RULE ? 3 : 2);
+
+    /* positions and jacobian determinants at quadrature points, QxB */
+    const MatrixXd X = quad.N * batch.Px, Y = quad.N * batch.Py, Z = quad.N * batch.Pz;
+    const ArrayXXd Jxr = (quad.dNdr * batch.Px).array(), Jxs = (quad.dNds * batch.Px).array(), Jxt = (quad.dNdt * batch.Px).array();
+    const ArrayXXd Jyr = (quad.dNdr * batch.Py).array(), Jys = (quad.dNds * batch.Py).array(), Jyt = (quad.dNdt * batch.Py).array();
+    const ArrayXXd Jzr = (quad.dNdr * batch.Pz).array(), Jzs = (quad.dNds * batch.Pz).array(), Jzt = (quad.dNdt * batch.Pz).array();
+    const ArrayXXd detJ = (Jxr * (Jys * Jzt - Jyt * Jzs) -
+                           Jxs * (Jyr * Jzt - Jyt * Jzr) +
+                           Jxt * (Jyr * Jzs - Jys * Jzr)).abs();
+
+    /* sample reference field */
+    ArrayXXd F(quad.pointNum, bsize);
+    for (int b = 0; b < bsize; b++)
+        for (int q = 0; q < quad.pointNum; q++)
+            F(q, b) = RefDensityField(Vector3d(X(q, b), Y(q, b), Z(q, b)));
+
+    /* weighted average, degenerated cells fall back to the plain average of samples */
+    const RowVectorXd num = quad.W.transpose() * (F * detJ).matrix();
+    const RowVectorXd den = quad.W.transpose() * detJ.matrix();
+    for (int b = 0; b < bsize; b++)
+        refDensity[b] = (den(b) > 0) ? num(b) / den(b) : F.col(b).mean();
 }
 
 /*
- * GetDiffDensityField()
- * DESCRIPTION: evaluate difference of reference field and actual field
+ * getDirtyCells()
+ * DESCRIPTION: get indexes of cells whose values could not be reused from the previous mesh
+ * INPUT: CellOrigin - index of each cell in the previous mesh, -1 if the cell is new or modified
+ *        oldNum - number of cells of the previous mesh
+ * OUTPUT: none
+ * RETURN: indexes of dirty cells
+ */
+static std::vector<int> getDirtyCells(const std::vector<int> &CellOrigin, size_t oldNum)
+{
+    std::vector<int> dirtyC;
+    for (size_t cIdx = 0; cIdx < CellOrigin.size(); cIdx++)
+        if (CellOrigin[cIdx] < 0 || (size_t)CellOrigin[cIdx] >= oldNum)
+            dirtyC.push_back(cIdx);
+    return dirtyC;
+}
+
+/*
+ * UpdateDensityField()
+ * DESCRIPTION: update density field after the mesh is modified, only new or modified cells are evaluated,
+ *              densities of other cells are reused from the previous density field
+ *              anisotropic metric shares edge metrics between cells, thus is evaluated on the whole mesh
  * INPUT: V - 3xd matrix, each column is a vertex of a mesh
  *        C - 8xd matrix, each column is a cell of a mesh, each cells contains 8 indexes of 8 vertexes in V
  *            following vtk convention
- * OUTPUT: difference density field in HexEvaluator
+ *        metric - density metric, must be the same as the one used for the previous density field
+ *        CellOrigin - index of each cell in the previous mesh, -1 if the cell is new or modified
+ * OUTPUT: densityfield in HexEvaluator
+ * RETURN: 0 if success, -1 if failed
+ */
+int HexEvaluator::UpdateDensityField(const Ref<const Matrix3Xd> &V, const Ref<const MatrixXi> &C, DensityMetric metric, const std::vector<int> &CellOrigin)
+{
+    if (C.rows() != HEX_SIZE || CellOrigin.size() != (size_t)C.cols())
+        return -1;
+
+    if (metric == ANISOTROPIC_METRIC || DensityField.empty())
+        return EvalDensityField(V, C, metric);
+
+    /* reuse densities of unchanged cells */
+    std::vector<int> dirtyC = getDirtyCells(CellOrigin, DensityField.size());
+    std::vector<double> field(C.cols());
+    for (size_t cIdx = 0; cIdx < CellOrigin.size(); cIdx++)
+        if (CellOrigin[cIdx] >= 0 && (size_t)CellOrigin[cIdx] < DensityField.size())
+            field[cIdx] = DensityField[CellOrigin[cIdx]];
+
+    /* evaluate dirty cells */
+    CellMetrics metrics;
+    if (metric == VOLUME_METRIC)
+    {
+        EvalCellMetrics(V, C, dirtyC, CELL_VOLUME, metrics);
+        for (size_t i = 0; i < dirtyC.size(); i++)
+            field[dirtyC[i]] = 1 / metrics.volume[i];
+    }
+    else if (metric == EDGE_LENGTH_METRIC)
+    {
+        EvalCellMetrics(V, C, dirtyC, CELL_EDGE_LENGTH, metrics);
+        for (size_t i = 0; i < dirtyC.size(); i++)
+            field[dirtyC[i]] = 12 / metrics.sqrEdgeLength[i];
+    }
+    else
+    {
+        std::cout << "HexEval::HexEvaluator::UpdateDensityField Error:" << std::endl;
+        std::cout << "    No such evaluation method." << std::endl;
+        return -1;
+    }
+
+    DensityField.swap(field);
+    return 0;
+}
+
+/*
+ * UpdateRefDensityField()
+ * DESCRIPTION: update reference density field after the mesh is modified, only new or modified cells are evaluated,
+ *              values of other cells are reused from the previous reference density field
+ * INPUT: V - 3xd matrix, each column is a vertex of a mesh
+ *        C - 8xd matrix, each column is a cell of a mesh, each cells contains 8 indexes of 8 vertexes in V
+ *            following vtk convention
+ *        CellOrigin - index of each cell in the previous mesh, -1 if the cell is new or modified
+ *        RefDensity - reference density field of the previous mesh
+ *        the whole mesh is evaluated if CellOrigin does not match C
+ * OUTPUT: RefDensity - reference density field of the current mesh
  * RETURN: none
  */
-std::vector<double> HexEvaluator::GetDiffDensityField(const Eigen::Matrix3Xd &V, const Eigen::MatrixXi &C)
+void HexEvaluator::UpdateRefDensityField(const Ref<const Matrix3Xd> &V, const Ref<const MatrixXi> &C, const std::vector<int> &CellOrigin, std::vector<double> &RefDensity)
 {
-    std::vector<double> diffField;
-    for (int cIdx = 0; cIdx < C.cols(); cIdx++)
+    if (CellOrigin.size() != (size_t)C.cols())
     {
-        MatrixXi c = C.col(cIdx);
-        diffField.push_back(DensityField.at(cIdx)-EvalDensity(V, c, RefDensityField));
+        RefDensity = GetRefDensityField(V, C);
+        return;
     }
+
+    /* reuse values of unchanged cells */
+    std::vector<int> dirtyC = getDirtyCells(CellOrigin, RefDensity.size());
+    std::vector<double> refField(C.cols());
+    for (size_t cIdx = 0; cIdx < CellOrigin.size(); cIdx++)
+        if (CellOrigin[cIdx] >= 0 && (size_t)CellOrigin[cIdx] < RefDensity.size())
+            refField[cIdx] = RefDensity[CellOrigin[cIdx]];
+
+    /* evaluate dirty cells */
+    ForEachHexBatch(V, C, dirtyC, [&](const HexBatch &batch, int begin)
+                    {
+        double refDensity[HEX_BATCH_SIZE];
+        EvalRefDensity(batch, refDensity);
+        for (int b = 0; b < batch.size; b++)
+            refField[dirtyC[begin + b]] = refDensity[b]; });
+
+    RefDensity.swap(refField);
+}
+
+/*
+ * GetDiffDensityField()
+ * DESCRIPTION: evaluate difference of reference field and actual field
+ * INPUT: V - 3xd matrix, each column is a vertex of a mesh
+ *        C - 8xd matrix, each column is a cell of a mesh, each cells contains 8 indexes of 8 vertexes in V
+ *            following vtk convention
+ * OUTPUT: none
+ * RETURN: difference density field
+ */
+std::vector<double> HexEvaluator::GetDiffDensityField(const Eigen::Ref<const Eigen::Matrix3Xd> &V, const Eigen::Ref<const Eigen::MatrixXi> &C)
+{
+    std::vector<double> diffField = GetRefDensityField(V, C);
+    for (size_t cIdx = 0; cIdx < diffField.size(); cIdx++)
+        diffField[cIdx] = DensityField.at(cIdx) - diffField[cIdx];
     return diffField;
 }
 
+/*
+ * setRefDensityRule()
+ * DESCRIPTION: set the rule used to evaluate reference density of a cell
+ * INPUT: rule - CORNER_AVERAGE_RULE, GAUSS_2_RULE or GAUSS_3_RULE
+ * OUTPUT: reference density rule in HexEvaluator
+ * RETURN: none
+ */
+void HexEvaluator::setRefDensityRule(RefDensityRule rule)
+{
+    RefRule = rule;
+}
+
+/*
+ * setDensityField()
+ * DESCRIPTION: set density field evaluated before, e.g. restored from a snapshot,
+ *              so that UpdateDensityField could reuse it
+ * INPUT: density of each cell
+ * OUTPUT: densityfield in HexEvaluator
+ * RETURN: none
+ */
+void HexEvaluator::setDensityField(const std::vector<double> &Density)
+{
+    DensityField = Density;
+}
+
 /*
  * setRefDensityField()
  * DESCRIPTION: set reference density field
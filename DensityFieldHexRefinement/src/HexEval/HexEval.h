@@ -47,6 +47,13 @@ namespace HexEval
         ANISOTROPIC_METRIC
     };
 
+    enum RefDensityRule
+    {
+        CORNER_AVERAGE_RULE,
+        GAUSS_2_RULE,
+        GAUSS_3_RULE
+    };
+
     const unsigned int HexEdge[12][2] =
         {
             {0, 1},
@@ -63,31 +70,45 @@ namespace HexEval
             {3, 7},
     };
 
+    class HexBatch;
+
+    /*
+     * HexEvaluator
+     * DESCRIPTION: evaluate density fields of a hex mesh
+     *              V, C are read-only views, so Eigen::Map of other contiguous vertex / cell storage
+     *              is evaluated in place without copy
+     */
     class HexEvaluator
     {
     public:
         // HexEvaluator() : RefDensityField(nullptr), AnisotropicDensityField(nullptr) {};
         // ~HexEvaluator();
 
-        int EvalDensityField(const Eigen::Matrix3Xd &V, const Eigen::MatrixXi &C, DensityMetric metric);
-        std::vector<double> GetRefDensityField(const Eigen::Matrix3Xd &V, const Eigen::MatrixXi &C);
-        std::vector<double> GetDiffDensityField(const Eigen::Matrix3Xd &V, const Eigen::MatrixXi &C);
+        int EvalDensityField(const Eigen::Ref<const Eigen::Matrix3Xd> &V, const Eigen::Ref<const Eigen::MatrixXi> &C, DensityMetric metric);
+        std::vector<double> GetRefDensityField(const Eigen::Ref<const Eigen::Matrix3Xd> &V, const Eigen::Ref<const Eigen::MatrixXi> &C);
+        std::vector<double> GetDiffDensityField(const Eigen::Ref<const Eigen::Matrix3Xd> &V, const Eigen::Ref<const Eigen::MatrixXi> &C);
         std::vector<double> GetDensityField();
 
+        int UpdateDensityField(const Eigen::Ref<const Eigen::Matrix3Xd> &V, const Eigen::Ref<const Eigen::MatrixXi> &C, DensityMetric metric, const std::vector<int> &CellOrigin);
+        void UpdateRefDensityField(const Eigen::Ref<const Eigen::Matrix3Xd> &V, const Eigen::Ref<const Eigen::MatrixXi> &C, const std::vector<int> &CellOrigin, std::vector<double> &RefDensity);
+
         void setRefDensityField(const std::function<double(Eigen::Vector3d)> &DensityField);
         void setAnisotropicDensityField(std::function<Eigen::Matrix3d(Eigen::Vector3d)> &DensityField);
+        void setRefDensityRule(RefDensityRule rule);
+        void setDensityField(const std::vector<double> &Density);
 
     private:
         std::vector<double> DensityField;
-        std::unordered_map<Edge, double> EdgeLenMap;
-        std::unordered_map<Edge, double> EdgeAnisotropicMetricMap;
+        std::vector<double> EdgeAnisotropicMetric;
 
         std::function<double(Eigen::Vector3d)> RefDensityField;
         std::function<Eigen::Matrix3d(Eigen::Vector3d)> AnisotropicDensityField;
+        RefDensityRule RefRule = GAUSS_2_RULE;
 
-        void EvalVolDensity(const Eigen::Matrix3Xd &V, const Eigen::MatrixXi &C);
-        void EvalLenDensity(const Eigen::Matrix3Xd &V, const Eigen::MatrixXi &C);
-        void EvalAnisotropicDensity(const Eigen::Matrix3Xd &V, const Eigen::MatrixXi &C);
+        void EvalVolDensity(const Eigen::Ref<const Eigen::Matrix3Xd> &V, const Eigen::Ref<const Eigen::MatrixXi> &C);
+        void EvalLenDensity(const Eigen::Ref<const Eigen::Matrix3Xd> &V, const Eigen::Ref<const Eigen::MatrixXi> &C);
+        void EvalAnisotropicDensity(const Eigen::Ref<const Eigen::Matrix3Xd> &V, const Eigen::Ref<const Eigen::MatrixXi> &C);
+        void EvalRefDensity(const HexBatch &batch, double *refDensity) const;
     };
 }
 
@@ -0,0 +1,158 @@
+#include "heBatch.h"
+#include "HexEval.h"
+
+using namespace HexEval;
+using namespace Eigen;
+
+/* constructior for class HexBatch */
+HexBatch::HexBatch() : size(0) {}
+
+/*
+ * gather()
+ * DESCRIPTION: gather corners of cells [cBegin, cEnd) into SoA buffers
+ * INPUT: V - 3xd matrix, each column is a vertex of a mesh
+ *        C - 8xd matrix, each column is a cell of a mesh, each cells contains 8 indexes of 8 vertexes in V
+ *            following vtk convention
+ *        cBegin, cEnd - range of cell indexes
+ * OUTPUT: Px, Py, Pz of the batch
+ * RETURN: none
+ */
+void HexBatch::gather(const Ref<const Matrix3Xd> &V, const Ref<const MatrixXi> &C, int cBegin, int cEnd)
+{
+    size = cEnd - cBegin;
+    Px.resize(8, size);
+    Py.resize(8, size);
+    Pz.resize(8, size);
+
+    for (int b = 0; b < size; b++)
+        for (int i = 0; i < 8; i++)
+        {
+            const int vIdx = C(i, cBegin + b);
+            Px(i, b) = V(0, vIdx);
+            Py(i, b) = V(1, vIdx);
+            Pz(i, b) = V(2, vIdx);
+        }
+}
+
+/*
+ * gather()
+ * DESCRIPTION: gather corners of the given cells into SoA buffers
+ * INPUT: V - 3xd matrix, each column is a vertex of a mesh
+ *        C - 8xd matrix, each column is a cell of a mesh, each cells contains 8 indexes of 8 vertexes in V
+ *            following vtk convention
+ *        cIdx - array of cell indexes
+ *        n - number of cells
+ * OUTPUT: Px, Py, Pz of the batch
+ * RETURN: none
+ */
+void HexBatch::gather(const Ref<const Matrix3Xd> &V, const Ref<const MatrixXi> &C, const int *cIdx, int n)
+{
+    size = n;
+    Px.resize(8, size);
+    Py.resize(8, size);
+    Pz.resize(8, size);
+
+    for (int b = 0; b < size; b++)
+        for (int i = 0; i < 8; i++)
+        {
+            const int vIdx = C(i, cIdx[b]);
+            Px(i, b) = V(0, vIdx);
+            Py(i, b) = V(1, vIdx);
+            Pz(i, b) = V(2, vIdx);
+        }
+}
+
+/*
+ * volume()
+ * DESCRIPTION: calculate volume of each cell of the batch using algorithm described in
+ *              J. Grandy. Efficient computation of volume of hexahedral cells.
+ *              Lawrence Livermore National Laboratory, October 1997. UCRL-ID-128886.
+ * INPUT: none
+ * OUTPUT: none
+ * RETURN: volume of each cell of the batch
+ */
+ArrayXd HexBatch::volume() const
+{
+    /* coordinate difference of two rows, i.e. (vi - vj) of all cells in the batch */
+    auto dx = [this](int i, int j) { return (Px.row(i) - Px.row(j)).transpose().array(); };
+    auto dy = [this](int i, int j) { return (Py.row(i) - Py.row(j)).transpose().array(); };
+    auto dz = [this](int i, int j) { return (Pz.row(i) - Pz.row(j)).transpose().array(); };
+
+    /* determinant of [a b c] = a . (b x c) */
+    auto det = [&](int a0, int a1, int b0, int b1, int c0, int c1) -> ArrayXd
+    {
+        const ArrayXd ax = dx(a0, a1), ay = dy(a0, a1), az = dz(a0, a1);
+        const ArrayXd bx = dx(b0, b1), by = dy(b0, b1), bz = dz(b0, b1);
+        const ArrayXd cx = dx(c0, c1), cy = dy(c0, c1), cz = dz(c0, c1);
+        return ax * (by * cz - bz * cy) + ay * (bz * cx - bx * cz) + az * (bx * cy - by * cx);
+    };
+
+    return (det(6, 0, 1, 0, 2, 5) + det(6, 0, 4, 0, 5, 7) + det(6, 0, 3, 0, 7, 2)) / 6.;
+}
+
+/*
+ * sqrEdgeLength()
+ * DESCRIPTION: calculate sum of squared length of 12 edges of each cell of the batch
+ * INPUT: none
+ * OUTPUT: none
+ * RETURN: sum of squared edge length of each cell of the batch
+ */
+ArrayXd HexBatch::sqrEdgeLength() const
+{
+    ArrayXd len = ArrayXd::Zero(size);
+    for (int i = 0; i < 12; i++)
+    {
+        const int v1 = HexEdge[i][0], v2 = HexEdge[i][1];
+        len += (Px.row(v1) - Px.row(v2)).transpose().array().square() +
+               (Py.row(v1) - Py.row(v2)).transpose().array().square() +
+               (Pz.row(v1) - Pz.row(v2)).transpose().array().square();
+    }
+    return len;
+}
+
+/*
+ * EvalCellMetrics()
+ * DESCRIPTION: evaluate requested per-cell metrics of a mesh in one traversal
+ * INPUT: V - 3xd matrix, each column is a vertex of a mesh
+ *        C - 8xd matrix, each column is a cell of a mesh, each cells contains 8 indexes of 8 vertexes in V
+ *            following vtk convention
+ *        flags - bitwise or of CellMetricFlag
+ * OUTPUT: metrics - requested per-cell metrics, others are left empty
+ * RETURN: none
+ */
+void HexEval::EvalCellMetrics(const Ref<const Matrix3Xd> &V, const Ref<const MatrixXi> &C, int flags, CellMetrics &metrics)
+{
+    metrics.volume.assign((flags & CELL_VOLUME) ? C.cols() : 0, 0);
+    metrics.sqrEdgeLength.assign((flags & CELL_EDGE_LENGTH) ? C.cols() : 0, 0);
+
+    ForEachHexBatch(V, C, [&](const HexBatch &batch, int cBegin)
+                    {
+        if (flags & CELL_VOLUME)
+            Map<ArrayXd>(metrics.volume.data() + cBegin, batch.size) = batch.volume();
+        if (flags & CELL_EDGE_LENGTH)
+            Map<ArrayXd>(metrics.sqrEdgeLength.data() + cBegin, batch.size) = batch.sqrEdgeLength(); });
+}
+
+/*
+ * EvalCellMetrics()
+ * DESCRIPTION: evaluate requested per-cell metrics of the given cells of a mesh in one traversal
+ * INPUT: V - 3xd matrix, each column is a vertex of a mesh
+ *        C - 8xd matrix, each column is a cell of a mesh, each cells contains 8 indexes of 8 vertexes in V
+ *            following vtk convention
+ *        CIdx - indexes of cells to be evaluated
+ *        flags - bitwise or of CellMetricFlag
+ * OUTPUT: metrics - requested per-cell metrics in the order of CIdx, others are left empty
+ * RETURN: none
+ */
+void HexEval::EvalCellMetrics(const Ref<const Matrix3Xd> &V, const Ref<const MatrixXi> &C, const std::vector<int> &CIdx, int flags, CellMetrics &metrics)
+{
+    metrics.volume.assign((flags & CELL_VOLUME) ? CIdx.size() : 0, 0);
+    metrics.sqrEdgeLength.assign((flags & CELL_EDGE_LENGTH) ? CIdx.size() : 0, 0);
+
+    ForEachHexBatch(V, C, CIdx, [&](const HexBatch &batch, int begin)
+                    {
+        if (flags & CELL_VOLUME)
+            Map<ArrayXd>(metrics.volume.data() + begin, batch.size) = batch.volume();
+        if (flags & CELL_EDGE_LENGTH)
+            Map<ArrayXd>(metrics.sqrEdgeLength.data() + begin, batch.size) = batch.sqrEdgeLength(); });
+}
@@ -0,0 +1,112 @@
+#ifndef HE_BATCH_H
+#define HE_BATCH_H
+
+#include <vector>
+#include <algorithm>
+#include <eigen3/Eigen/Eigen>
+
+namespace HexEval
+{
+    /* number of cells gathered in one batch */
+    const int HEX_BATCH_SIZE = 64;
+
+    /* per-cell metrics which could be evaluated in one traversal, used as bit flags */
+    enum CellMetricFlag
+    {
+        CELL_VOLUME = 0x01,
+        CELL_EDGE_LENGTH = 0x02
+    };
+
+    struct CellMetrics
+    {
+        std::vector<double> volume;        // volume of each cell
+        std::vector<double> sqrEdgeLength; // sum of squared length of 12 edges of each cell
+    };
+
+    /*
+     * HexBatch
+     * DESCRIPTION: corners of a block of hex cells gathered into SoA buffers
+     *              Px, Py, Pz - 8xB matrix, coordinates of 8 corners of B cells
+     *              per-cell kernels run on the whole block using array expressions
+     */
+    class HexBatch
+    {
+    public:
+        int size;
+        Eigen::Matrix<double, 8, Eigen::Dynamic> Px, Py, Pz;
+
+        HexBatch();
+
+        void gather(const Eigen::Ref<const Eigen::Matrix3Xd> &V, const Eigen::Ref<const Eigen::MatrixXi> &C, int cBegin, int cEnd);
+        void gather(const Eigen::Ref<const Eigen::Matrix3Xd> &V, const Eigen::Ref<const Eigen::MatrixXi> &C, const int *cIdx, int n);
+
+        Eigen::ArrayXd volume() const;
+        Eigen::ArrayXd sqrEdgeLength() const;
+    };
+
+    /*
+     * ForEachHexBatch()
+     * DESCRIPTION: traverse all cells of a mesh in batches in parallel,
+     *              corners of each batch are gathered once then passed to the kernel
+     * INPUT: V - 3xd matrix, each column is a vertex of a mesh
+     *        C - 8xd matrix, each column is a cell of a mesh, each cells contains 8 indexes of 8 vertexes in V
+     *            following vtk convention
+     *        kernel - callable as kernel(const HexBatch &batch, int cBegin)
+     * OUTPUT: none
+     * RETURN: none
+     */
+    template <class Kernel>
+    void ForEachHexBatch(const Eigen::Ref<const Eigen::Matrix3Xd> &V, const Eigen::Ref<const Eigen::MatrixXi> &C, Kernel kernel)
+    {
+        const int cnum = C.cols();
+        const int blockNum = (cnum + HEX_BATCH_SIZE - 1) / HEX_BATCH_SIZE;
+
+        #pragma omp parallel
+        {
+            HexBatch batch;
+            #pragma omp for schedule(dynamic)
+            for (int bIdx = 0; bIdx < blockNum; bIdx++)
+            {
+                const int cBegin = bIdx * HEX_BATCH_SIZE;
+                batch.gather(V, C, cBegin, std::min(cBegin + HEX_BATCH_SIZE, cnum));
+                kernel(batch, cBegin);
+            }
+        }
+    }
+
+    /*
+     * ForEachHexBatch()
+     * DESCRIPTION: traverse the given cells of a mesh in batches in parallel
+     * INPUT: V - 3xd matrix, each column is a vertex of a mesh
+     *        C - 8xd matrix, each column is a cell of a mesh, each cells contains 8 indexes of 8 vertexes in V
+     *            following vtk convention
+     *        CIdx - indexes of cells to be traversed
+     *        kernel - callable as kernel(const HexBatch &batch, int begin),
+     *                 cells of the batch are CIdx[begin], CIdx[begin + 1], ...
+     * OUTPUT: none
+     * RETURN: none
+     */
+    template <class Kernel>
+    void ForEachHexBatch(const Eigen::Ref<const Eigen::Matrix3Xd> &V, const Eigen::Ref<const Eigen::MatrixXi> &C, const std::vector<int> &CIdx, Kernel kernel)
+    {
+        const int cnum = CIdx.size();
+        const int blockNum = (cnum + HEX_BATCH_SIZE - 1) / HEX_BATCH_SIZE;
+
+        #pragma omp parallel
+        {
+            HexBatch batch;
+            #pragma omp for schedule(dynamic)
+            for (int bIdx = 0; bIdx < blockNum; bIdx++)
+            {
+                const int begin = bIdx * HEX_BATCH_SIZE;
+                batch.gather(V, C, CIdx.data() + begin, std::min(HEX_BATCH_SIZE, cnum - begin));
+                kernel(batch, begin);
+            }
+        }
+    }
+
+    void EvalCellMetrics(const Eigen::Ref<const Eigen::Matrix3Xd> &V, const Eigen::Ref<const Eigen::MatrixXi> &C, int flags, CellMetrics &metrics);
+    void EvalCellMetrics(const Eigen::Ref<const Eigen::Matrix3Xd> &V, const Eigen::Ref<const Eigen::MatrixXi> &C, const std::vector<int> &CIdx, int flags, CellMetrics &metrics);
+}
+
+#endif
@@ -0,0 +1,156 @@
+#include <cmath>
+#include <sstream>
+#include <string>
+#include <algorithm>
+#include "heError.h"
+
+using namespace HexEval;
+
+/*
+ * EvalDensityError()
+ * DESCRIPTION: evaluate error between actual density field and reference density field,
+ *              norms, relative norms, signed histogram and number of under-resolved cells are
+ *              gathered in one parallel pass
+ * INPUT: Density - density of each cell
+ *        RefDensity - reference density of each cell
+ *        histBins - number of histogram bins
+ * OUTPUT: report - error report of the mesh
+ * RETURN: none
+ */
+void HexEval::EvalDensityError(const std::vector<double> &Density, const std::vector<double> &RefDensity, ErrorReport &report,
+                               int histBins)
+{
+    const int cnum = std::min(Density.size(), RefDensity.size());
+    const double histMin = -1, histMax = 1;
+
+    double l1 = 0, l2 = 0, linf = 0, signedSum = 0;
+    double refL1 = 0, refL2 = 0, refLinf = 0;
+    int underResolvedNum = 0;
+    std::vector<int> histogram(histBins, 0);
+
+    #pragma omp parallel
+    {
+        double localL1 = 0, localL2 = 0, localLinf = 0, localSigned = 0;
+        double localRefL1 = 0, localRefL2 = 0, localRefLinf = 0;
+        int localUnder = 0;
+        std::vector<int> localHist(histBins, 0);
+
+        #pragma omp for schedule(static) nowait
+        for (int cIdx = 0; cIdx < cnum; cIdx++)
+        {
+            const double ref = RefDensity[cIdx];
+            const double err = Density[cIdx] - ref;
+            const double absErr = std::abs(err), absRef = std::abs(ref);
+
+            localL1 += absErr;
+            localL2 += err * err;
+            localLinf = std::max(localLinf, absErr);
+            localSigned += err;
+            localRefL1 += absRef;
+            localRefL2 += ref * ref;
+            localRefLinf = std::max(localRefLinf, absRef);
+            localUnder += (err < 0);
+
+            if (histBins > 0)
+            {
+                /* cells with zero reference go to the end bins by the sign of error */
+                const double relErr = (absRef > 0) ? err / absRef : (err < 0 ? histMin : histMax);
+                /* clamp before the cast, the relative error is huge if the reference is tiny */
+                const double bin = std::floor((relErr - histMin) / (histMax - histMin) * histBins);
+                localHist[(int)std::max(0.0, std::min(histBins - 1.0, bin))]++;
+            }
+        }
+
+        #pragma omp critical
+        {
+            l1 += localL1;
+            l2 += localL2;
+            linf = std::max(linf, localLinf);
+            signedSum += localSigned;
+            refL1 += localRefL1;
+            refL2 += localRefL2;
+            refLinf = std::max(refLinf, localRefLinf);
+            underResolvedNum += localUnder;
+            for (int i = 0; i < histBins; i++)
+                histogram[i] += localHist[i];
+        }
+    }
+
+    report.cellNum = cnum;
+    report.underResolvedNum = underResolvedNum;
+    report.l1 = cnum ? l1 / cnum : 0;
+    report.l2 = cnum ? std::sqrt(l2 / cnum) : 0;
+    report.linf = linf;
+    report.relL1 = (refL1 > 0) ? l1 / refL1 : 0;
+    report.relL2 = (refL2 > 0) ? std::sqrt(l2 / refL2) : 0;
+    report.relLinf = (refLinf > 0) ? linf / refLinf : 0;
+    report.meanSigned = cnum ? signedSum / cnum : 0;
+    report.histMin = histMin;
+    report.histMax = histMax;
+    report.histogram = histogram;
+}
+
+/*
+ * PrintErrorReport()
+ * DESCRIPTION: print density error report in text
+ * INPUT: report - density error report
+ *        os - output stream
+ * OUTPUT: error report in text
+ * RETURN: none
+ */
+void HexEval::PrintErrorReport(const ErrorReport &report, std::ostream &os)
+{
+    const double underFraction = report.cellNum ? (double)report.underResolvedNum / report.cellNum : 0;
+
+    os << "Density error of " << report.cellNum << " cells" << std::endl;
+    os << "  L1: " << report.l1 << ", L2: " << report.l2 << ", Linf: " << report.linf << std::endl;
+    os << "  relative L1: " << report.relL1 << ", L2: " << report.relL2 << ", Linf: " << report.relLinf << std::endl;
+    os << "  mean signed error: " << report.meanSigned << std::endl;
+    os << "  under-resolved: " << report.underResolvedNum << " (" << underFraction * 100 << "%)" << std::endl;
+    os << "  relative signed error histogram [" << report.histMin << ", " << report.histMax << "]:";
+    for (int count : report.histogram)
+        os << " " << count;
+    os << std::endl;
+}
+
+/* a number in json, which has no inf or nan */
+static std::string jsonNumber(double x)
+{
+    if (!std::isfinite(x))
+        return "null";
+    std::ostringstream ss;
+    ss << x;
+    return ss.str();
+}
+
+/*
+ * PrintErrorReportJson()
+ * DESCRIPTION: print density error report in json
+ * INPUT: report - density error report
+ *        os - output stream
+ * OUTPUT: error report in json, non-finite values are null since json has no inf or nan
+ * RETURN: none
+ */
+void HexEval::PrintErrorReportJson(const ErrorReport &report, std::ostream &os)
+{
+    const double underFraction = report.cellNum ? (double)report.underResolvedNum / report.cellNum : 0;
+
+    os << "{\n";
+    os << "  \"cellNum\": " << report.cellNum << ",\n";
+    os << "  \"l1\": " << jsonNumber(report.l1) << ",\n";
+    os << "  \"l2\": " << jsonNumber(report.l2) << ",\n";
+    os << "  \"linf\": " << jsonNumber(report.linf) << ",\n";
+    os << "  \"relL1\": " << jsonNumber(report.relL1) << ",\n";
+    os << "  \"relL2\": " << jsonNumber(report.relL2) << ",\n";
+    os << "  \"relLinf\": " << jsonNumber(report.relLinf) << ",\n";
+    os << "  \"meanSigned\": " << jsonNumber(report.meanSigned) << ",\n";
+    os << "  \"underResolvedNum\": " << report.underResolvedNum << ",\n";
+    os << "  \"underResolvedFraction\": " << jsonNumber(underFraction) << ",\n";
+    os << "  \"histMin\": " << jsonNumber(report.histMin) << ",\n";
+    os << "  \"histMax\": " << jsonNumber(report.histMax) << ",\n";
+    os << "  \"histogram\": [";
+    for (size_t i = 0; i < report.histogram.size(); i++)
+        os << (i ? ", " : "") << report.histogram[i];
+    os << "]\n";
+    os << "}" << std::endl;
+}
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include "heIntegral.h"
 
 using namespace std;
@@ -9,6 +10,7 @@ double HexEval::integrateRectangle(double a, double b, function<double(double)>
 {
 	double h, result, t; // result este A din pdf, t este B din pdf
 	h = (b - a) / n;
+	result = 0;
 
 	for (int i = 0; i < n; i++)
 		result = result + h * f(a + i * h);
@@ -155,3 +157,56 @@ double HexEval::integrateBoole(double StartPoint, double EndPoint, int n, std::f
 	}
 	return sum;
 }
+
+
+/*
+ * gaussLegendreSegment()
+ * DESCRIPTION: integrate f over [a, b] using 2-point and 3-point Gauss-Legendre rules,
+ *              the difference of the two rules is used as the error estimate,
+ *              bisect the segment until the estimate is below the absolute tolerance
+ * INPUT: a, b - integration interval
+ *        f - integrand
+ *        absTol - absolute tolerance of this segment
+ *        depth - remaining number of bisections
+ * OUTPUT: none
+ * RETURN: integral of f over [a, b]
+ */
+static double gaussLegendreSegment(double a, double b, const function<double(double)> &f, double absTol, int depth)
+{
+	const double c = (a + b) / 2.0, h = (b - a) / 2.0;
+	const double x2 = h / sqrt(3.0), x3 = h * sqrt(0.6);
+	const double g2 = h * (f(c - x2) + f(c + x2));
+	const double g3 = h * (5.0 * f(c - x3) + 8.0 * f(c) + 5.0 * f(c + x3)) / 9.0;
+
+	if (depth <= 0 || abs(g3 - g2) <= absTol)
+		return g3;
+
+	return gaussLegendreSegment(a, c, f, absTol / 2.0, depth - 1) +
+		   gaussLegendreSegment(c, b, f, absTol / 2.0, depth - 1);
+}
+
+/*
+ * integrateGaussLegendre()
+ * DESCRIPTION: adaptive Gauss-Legendre integration with error control,
+ *              smooth integrands converge on the first segment, i.e. using 5 evaluations of f
+ * INPUT: a, b - integration interval
+ *        f - integrand
+ *        tol - relative tolerance
+ *        maxDepth - maximum number of bisections
+ * OUTPUT: none
+ * RETURN: integral of f over [a, b]
+ */
+double HexEval::integrateGaussLegendre(double a, double b, function<double(double)> f, double tol, int maxDepth)
+{
+	const double c = (a + b) / 2.0, h = (b - a) / 2.0;
+	const double x2 = h / sqrt(3.0), x3 = h * sqrt(0.6);
+	const double g2 = h * (f(c - x2) + f(c + x2));
+	const double g3 = h * (5.0 * f(c - x3) + 8.0 * f(c) + 5.0 * f(c + x3)) / 9.0;
+	const double absTol = tol * max(abs(g3), epsilon);
+
+	if (maxDepth <= 0 || abs(g3 - g2) <= absTol)
+		return g3;
+
+	return gaussLegendreSegment(a, c, f, absTol / 2.0, maxDepth - 1) +
+		   gaussLegendreSegment(c, b, f, absTol / 2.0, maxDepth - 1);
+}
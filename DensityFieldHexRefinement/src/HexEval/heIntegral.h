@@ -15,6 +15,7 @@ namespace HexEval
     double gauss2(double a, double b, double n, std::function<double(double)> f);
     double gauss3(double a, double b, double n, std::function<double(double)> f);
     double integrateBoole(double StartPoint, double EndPoint, int n, std::function<double(double)> f);
+    double integrateGaussLegendre(double a, double b, std::function<double(double)> f, double tol, int maxDepth);
 }
 
 #endif
\ No newline at end of file
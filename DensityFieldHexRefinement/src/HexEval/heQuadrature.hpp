@@ -0,0 +1,93 @@
+#ifndef HE_QUADRATURE_HPP
+#define HE_QUADRATURE_HPP
+
+#include <cmath>
+#include <eigen3/Eigen/Eigen>
+
+namespace HexEval
+{
+    /* parametric coordinates of 8 vertexes of the reference hex [0,1]^3 following vtk convention */
+    const double HexParamCoord[8][3] =
+        {
+            {0, 0, 0},
+            {1, 0, 0},
+            {1, 1, 0},
+            {0, 1, 0},
+            {0, 0, 1},
+            {1, 0, 1},
+            {1, 1, 1},
+            {0, 1, 1},
+    };
+
+    /*
+     * HexQuadrature
+     * DESCRIPTION: tensor-product Gauss-Legendre rule over the reference hex [0,1]^3 with
+     *              trilinear shape functions and their derivatives precomputed at each point
+     *              N, dNdr, dNds, dNdt - Qx8 matrix, value of 8 shape functions at Q points
+     *              W - weights of Q points, sum of weights is 1
+     */
+    struct HexQuadrature
+    {
+        int pointNum;
+        Eigen::MatrixXd N, dNdr, dNds, dNdt;
+        Eigen::VectorXd W;
+
+        explicit HexQuadrature(int order)
+        {
+            double x[3], w[3];
+            if (order == 3)
+            {
+                x[0] = 0.5 - 0.5 * sqrt(0.6), x[1] = 0.5, x[2] = 0.5 + 0.5 * sqrt(0.6);
+                w[0] = 5.0 / 18.0, w[1] = 8.0 / 18.0, w[2] = 5.0 / 18.0;
+            }
+            else
+            {
+                order = 2;
+                x[0] = 0.5 - 0.5 / sqrt(3.0), x[1] = 0.5 + 0.5 / sqrt(3.0);
+                w[0] = 0.5, w[1] = 0.5;
+            }
+
+            pointNum = order * order * order;
+            N.resize(pointNum, 8);
+            dNdr.resize(pointNum, 8);
+            dNds.resize(pointNum, 8);
+            dNdt.resize(pointNum, 8);
+            W.resize(pointNum);
+
+            int q = 0;
+            for (int k = 0; k < order; k++)
+                for (int j = 0; j < order; j++)
+                    for (int i = 0; i < order; i++, q++)
+                    {
+                        const double r = x[i], s = x[j], t = x[k];
+                        W(q) = w[i] * w[j] * w[k];
+                        for (int n = 0; n < 8; n++)
+                        {
+                            /* 1D linear shape functions and their derivatives in each direction */
+                            const double nr = HexParamCoord[n][0] ? r : 1 - r, dr = HexParamCoord[n][0] ? 1 : -1;
+                            const double ns = HexParamCoord[n][1] ? s : 1 - s, ds = HexParamCoord[n][1] ? 1 : -1;
+                            const double nt = HexParamCoord[n][2] ? t : 1 - t, dt = HexParamCoord[n][2] ? 1 : -1;
+                            N(q, n) = nr * ns * nt;
+                            dNdr(q, n) = dr * ns * nt;
+                            dNds(q, n) = nr * ds * nt;
+                            dNdt(q, n) = nr * ns * dt;
+                        }
+                    }
+        }
+    };
+
+    /*
+     * GetHexQuadrature()
+     * DESCRIPTION: get the precomputed 2^3 or 3^3 Gauss rule, tables are built once
+     * INPUT: order - number of Gauss points in each direction, 2 or 3
+     * OUTPUT: none
+     * RETURN: the precomputed rule
+     */
+    inline const HexQuadrature &GetHexQuadrature(int order)
+    {
+        static const HexQuadrature gauss2(2), gauss3(3);
+        return (order == 3) ? gauss3 : gauss2;
+    }
+}
+
+#endif
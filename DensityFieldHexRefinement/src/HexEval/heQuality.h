@@ -0,0 +1,51 @@
+#ifndef HE_QUALITY_H
+#define HE_QUALITY_H
+
+#include <vector>
+#include <iostream>
+#include <eigen3/Eigen/Eigen>
+
+#include "heBatch.h"
+
+namespace HexEval
+{
+    /* number of histogram bins and number of worst cells recorded by default */
+    const int QUALITY_HIST_BINS = 10;
+    const int QUALITY_WORST_K = 10;
+
+    /*
+     * QualityStats
+     * DESCRIPTION: statistics of one quality metric over a mesh
+     *              histogram has uniform bins over [histMin, histMax], values out of range go to the end bins
+     *              worst - indexes of the worst cells, worst first
+     *              degenerateNum - number of cells whose value is not finite, excluded from min, max & mean
+     */
+    struct QualityStats
+    {
+        double min, max, mean;
+        int degenerateNum;
+        double histMin, histMax;
+        std::vector<int> histogram;
+        std::vector<int> worst;
+    };
+
+    struct QualityReport
+    {
+        int cellNum;
+        int invertedNum;             // number of cells with non-positive scaled jacobian
+        QualityStats scaledJacobian; // minimum scaled jacobian at 8 corners, the larger the better, 1 for a cube
+        QualityStats edgeRatio;      // longest edge over shortest edge, the smaller the better, 1 for a cube
+        QualityStats skew;           // maximum |cos| between principal axes, the smaller the better, 0 for a cube
+    };
+
+    Eigen::ArrayXd MinScaledJacobian(const HexBatch &batch);
+    Eigen::ArrayXd EdgeRatio(const HexBatch &batch);
+    Eigen::ArrayXd Skew(const HexBatch &batch);
+
+    void EvalQuality(const Eigen::Ref<const Eigen::Matrix3Xd> &V, const Eigen::Ref<const Eigen::MatrixXi> &C, QualityReport &report,
+                     std::vector<double> *scaledJacobian = nullptr,
+                     int histBins = QUALITY_HIST_BINS, int worstK = QUALITY_WORST_K);
+    void PrintQualityReport(const QualityReport &report, std::ostream &os);
+}
+
+#endif
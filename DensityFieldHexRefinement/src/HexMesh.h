@@ -0,0 +1,70 @@
+#ifndef HEX_MESH_H
+#define HEX_MESH_H
+
+#include <array>
+#include <vector>
+#include <eigen3/Eigen/Eigen>
+
+typedef std::array<int, 8> HexCell;
+typedef std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d>> HexVertexes;
+
+static_assert(sizeof(Eigen::Vector3d) == 3 * sizeof(double), "vertexes must be tightly packed");
+static_assert(sizeof(HexCell) == 8 * sizeof(int), "cells must be tightly packed");
+
+/*
+ * HexMesh
+ * DESCRIPTION: hex mesh storage shared by the refinement pipeline and the refinement engines
+ *              engines swap V, C into their own mesh and back, evaluators read V, C through
+ *              Eigen maps, so no copy is made between refinement and evaluation
+ *              V - vertexes, C - cells, each cell contains 8 indexes of 8 vertexes in V following vtk convention
+ */
+struct HexMesh
+{
+    HexVertexes V;
+    std::vector<HexCell> C;
+
+    /* 3xd view of vertexes, each column is a vertex */
+    Eigen::Map<const Eigen::Matrix3Xd> getV() const
+    {
+        return Eigen::Map<const Eigen::Matrix3Xd>(V.empty() ? nullptr : V.front().data(), 3, V.size());
+    }
+
+    /* 8xd view of cells, each column is a cell */
+    Eigen::Map<const Eigen::MatrixXi> getC() const
+    {
+        return Eigen::Map<const Eigen::MatrixXi>(C.empty() ? nullptr : C.front().data(), 8, C.size());
+    }
+};
+
+/*
+ * RefineTree
+ * DESCRIPTION: parent-children map of cells of one refinement in CSR layout
+ *              children of cell p of the coarse mesh are ChildC[ChildOffset[p]] ~ ChildC[ChildOffset[p + 1] - 1]
+ *              cells untouched by the refinement have exactly one child, i.e. itself in the fine mesh
+ */
+struct RefineTree
+{
+    std::vector<int> ChildOffset;
+    std::vector<int> ChildC;
+
+    int parentNum() const { return ChildOffset.empty() ? 0 : (int)ChildOffset.size() - 1; }
+    int childNum() const { return ChildC.size(); }
+
+    /*
+     * prolong()
+     * DESCRIPTION: copy per-cell data of the coarse mesh to the children in the fine mesh
+     * INPUT: coarse - per-cell data of the coarse mesh
+     * OUTPUT: fine - per-cell data of the fine mesh
+     * RETURN: none
+     */
+    template <class T>
+    void prolong(const std::vector<T> &coarse, std::vector<T> &fine) const
+    {
+        fine.resize(childNum());
+        for (int p = 0; p < parentNum(); p++)
+            for (int i = ChildOffset[p]; i < ChildOffset[p + 1]; i++)
+                fine[ChildC[i]] = coarse[p];
+    }
+};
+
+#endif
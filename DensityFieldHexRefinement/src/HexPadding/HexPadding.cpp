@@ -12,12 +12,17 @@ using namespace HexPadding;
  * padding()
  * DESCRIPTION: pad the target cells of a given mesh, i.e. add a layer of hex mesh
  * INPUT: hex mesh, indexes of target cells, flag of smoothing
- * OUTPUT: padded hex mesh
+ * OUTPUT: padded hex mesh, indexes of existing cells and vertexes modified by padding,
+ *         parent-children map of cells, i.e. a marked cell is the parent of itself and new cells padded on its surface faces
  * RETURN: none
  */
 void HexPadding::padding(Mesh &m, vector<size_t> markedC, bool smooth, bool markPadded)
 {
     Mesh markedSubMesh;
+    const size_t oldCNum = m.C.size();
+    vector<int> parent(oldCNum);
+    for (size_t cIdx = 0; cIdx < oldCNum; cIdx++)
+        parent.at(cIdx) = cIdx;
 
     /* mark marked cells */
     vector<bool> CFlag(m.C.size(), false);
@@ -54,20 +59,26 @@ void HexPadding::padding(Mesh &m, vector<size_t> markedC, bool smooth, bool mark
         if (CFlag.at(cIdx))
         {
             Cell &c = m.C.at(cIdx);
+            bool modified = false;
             for (auto &vIdx : c)
             {
                 /* if the vertexes has shrinked, i.e. a surface vertexes of submesh  *
                  * change it to its shrinked point                                   */
                 if (vMap.find(vIdx) != vMap.end())
+                {
                     vIdx = vMap.at(vIdx);
+                    modified = true;
+                }
             }
+            if (modified)
+                m.ModifiedC.push_back(cIdx);
         }
     }
 
     /* add new layers of cells into the target submesh */
     for (auto &fIdx : markedSubMesh.SurfaceF)
     {
-        Cell c(8);
+        Cell c;
         Face &f = markedSubMesh.F.at(fIdx);
 
         for (size_t i = 0; i < 4; i++)
@@ -77,11 +88,23 @@ void HexPadding::padding(Mesh &m, vector<size_t> markedC, bool smooth, bool mark
         }
 
         size_t cIdx = m.addCell(c);
+        parent.push_back(markedC.at(markedSubMesh.FaceC.at(fIdx)));
         markedC.push_back(cIdx);
         /* mark padded cells if needed */
         if (markPadded) m.PaddedC.push_back(cIdx);
     }
 
+    /* invert parent of each cell into parent-children map */
+    m.ChildOffset.assign(oldCNum + 1, 0);
+    m.ChildC.resize(m.C.size());
+    for (size_t cIdx = 0; cIdx < m.C.size(); cIdx++)
+        m.ChildOffset.at(parent.at(cIdx) + 1)++;
+    for (size_t p = 0; p < oldCNum; p++)
+        m.ChildOffset.at(p + 1) += m.ChildOffset.at(p);
+    vector<int> fill(m.ChildOffset.begin(), m.ChildOffset.end() - 1);
+    for (size_t cIdx = 0; cIdx < m.C.size(); cIdx++)
+        m.ChildC.at(fill.at(parent.at(cIdx))++) = cIdx;
+
     if (smooth)
     {
         /* smoothing */
@@ -90,6 +113,11 @@ void HexPadding::padding(Mesh &m, vector<size_t> markedC, bool smooth, bool mark
 
         for (int i = 0; i < SMOOTH_ITERNUM; i++)
             volSmoothingSubmeshUsingVerts(m, smoothSubMesh);
+
+        /* internal vertexes of the smoothed submesh are moved */
+        for (size_t vIdx : smoothSubMesh.SubV)
+            if (!smoothSubMesh.VinfoMap.at(vIdx).isBoundary)
+                m.ModifiedV.push_back(vIdx);
     }
 }
 
@@ -57,12 +57,13 @@ void Mesh::getGeometryInfo(){
  * getFaceInfo()
  * DESCRIPTION: get face info of the hex
  * INPUT: hex mesh
- * OUTPUT: face info of the mesh
+ * OUTPUT: face info of the mesh, a cell containing each face
  * RETURN: none
  */
 void Mesh::getFaceInfo()
 {
     F.clear();
+    FaceC.clear();
 
     vector<Face> totalF(C.size() * 6);
     vector<tuple<Face, size_t>> sortedF(C.size() * 6);
@@ -92,6 +93,7 @@ void Mesh::getFaceInfo()
 
     /* get F & boundary check */
     F.push_back(totalF.at(get<1>(sortedF.at(0))));
+    FaceC.push_back(get<1>(sortedF.at(0)) / 6);
     FinfoMap[F.size() - 1].isBoundary = true;
 
     for (size_t i = 1; i < sortedF.size(); i++)
@@ -100,6 +102,7 @@ void Mesh::getFaceInfo()
         {
             /* a new different face, add it into F */
             F.push_back(totalF.at(get<1>(sortedF.at(i))));
+            FaceC.push_back(get<1>(sortedF.at(i)) / 6);
             FinfoMap[F.size() - 1].isBoundary = true;
         }
         else
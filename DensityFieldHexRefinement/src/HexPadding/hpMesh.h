@@ -1,6 +1,7 @@
 #ifndef HEX_PADDING_MESH_H
 #define HEX_PADDING_MESH_H
 
+#include <array>
 #include <vector>
 #include <unordered_map>
 #include <algorithm>
@@ -8,7 +9,7 @@
 
 namespace HexPadding
 {
-    typedef std::vector<size_t> Cell;
+    typedef std::array<int, 8> Cell;
     typedef std::vector<size_t> Face;
     typedef std::pair<size_t, size_t> Edge;
     typedef Eigen::Vector3d Vert;
@@ -69,6 +70,7 @@ namespace HexPadding
         std::vector<Cell> C;
         std::vector<Edge> E;
         std::vector<Face> F;
+        std::vector<size_t> FaceC; // index of a cell containing each face
         // std::unordered_map<size_t, CellInfo> CinfoMap;
         std::unordered_map<size_t, FaceInfo> FinfoMap;
         // std::unordered_map<size_t, EdgeInfo> EinfoMap;
@@ -77,6 +79,10 @@ namespace HexPadding
         std::vector<size_t> SurfaceF;
         std::vector<size_t> SurfaceV;
         std::vector<size_t> PaddedC;
+        std::vector<size_t> ModifiedC; // indexes of existing cells modified in place by padding
+        std::vector<size_t> ModifiedV; // indexes of existing vertexes moved by padding
+        std::vector<int> ChildOffset;  // children of cell p before padding are ChildC[ChildOffset[p]] ~ ChildC[ChildOffset[p + 1] - 1]
+        std::vector<int> ChildC;
         MeshType cellType;
 
         Mesh();
@@ -120,15 +120,7 @@ inline size_t Mesh::addVertex(Vertex v){
  */
 inline int Mesh::addHexCell(size_t v0, size_t v1, size_t v2, size_t v3, 
                             size_t v4, size_t v5, size_t v6, size_t v7){
-    Cell c;
-    c.push_back(v0);
-    c.push_back(v1);
-    c.push_back(v2);
-    c.push_back(v3);
-    c.push_back(v4);
-    c.push_back(v5);
-    c.push_back(v6);
-    c.push_back(v7);
+    Cell c = {(int)v0, (int)v1, (int)v2, (int)v3, (int)v4, (int)v5, (int)v6, (int)v7};
     addedC.push_back(c);
     return C.size() + addedC.size() - 1;
 }
@@ -150,10 +142,22 @@ inline void Mesh::deleteCell(size_t idx){
  *              added cells & vertexes are truly added into mesh's C & V
  *              removed cells & vertexes are truly removed mesh's C & V
  * INPUT: none
- * OUTPUT: none
+ * OUTPUT: CellOrigin, parent-children map of cells ChildOffset & ChildC
  * RETURN: none
  */
 void Mesh::update(){
+    const size_t oldCNum = C.size();
+
+    /* record origin of each cell, added cells have no origin */
+    CellOrigin.resize(C.size() + addedC.size());
+    for(size_t i = 0; i < CellOrigin.size(); i++)
+        CellOrigin.at(i) = (i < C.size()) ? (int)i : -1;
+
+    /* record parent of each cell, existing cells are their own parents */
+    std::vector<int> parent(C.size() + addedC.size());
+    for(size_t i = 0; i < parent.size(); i++)
+        parent.at(i) = (i < C.size()) ? (int)i : (int)addedParent.at(i - C.size());
+
     /* added vertexes */
     for(size_t i = 0; i < addedV.size(); i++)
         V.push_back(addedV.at(i));
@@ -163,10 +167,35 @@ void Mesh::update(){
         C.push_back(addedC.at(i));
 
     /* delete all abandoned cells */
-    /* has to be deleted from big to small */
-    sort(abandonedC.rbegin(), abandonedC.rend());
+    /* remaining cells are compacted in one pass, keeping their order */
+    std::vector<bool> abandonedFlag(C.size(), false);
     for(size_t i = 0; i < abandonedC.size(); i++)
-        C.erase(C.begin()+abandonedC.at(i));
+        abandonedFlag.at(abandonedC.at(i)) = true;
+    size_t cNum = 0;
+    for(size_t i = 0; i < C.size(); i++){
+        if(abandonedFlag.at(i))
+            continue;
+        if(cNum != i){
+            C.at(cNum).swap(C.at(i));
+            CellOrigin.at(cNum) = CellOrigin.at(i);
+            parent.at(cNum) = parent.at(i);
+        }
+        cNum++;
+    }
+    C.resize(cNum);
+    CellOrigin.resize(cNum);
+    parent.resize(cNum);
+
+    /* invert parent of each cell into parent-children map */
+    ChildOffset.assign(oldCNum + 1, 0);
+    ChildC.resize(cNum);
+    for(size_t i = 0; i < cNum; i++)
+        ChildOffset.at(parent.at(i) + 1)++;
+    for(size_t p = 0; p < oldCNum; p++)
+        ChildOffset.at(p + 1) += ChildOffset.at(p);
+    std::vector<int> fill(ChildOffset.begin(), ChildOffset.end() - 1);
+    for(size_t i = 0; i < cNum; i++)
+        ChildC.at(fill.at(parent.at(i))++) = i;
 
     /* delete all abandoned vertexes */
     /* has to be deleted from big to small */
@@ -179,6 +208,7 @@ void Mesh::update(){
     std::vector<Cell>().swap(addedC);
     std::vector<size_t>().swap(abandonedV);
     std::vector<size_t>().swap(abandonedC);
+    std::vector<size_t>().swap(addedParent);
 }
 
 /*
@@ -303,7 +333,18 @@ void Mesh::removeConcavity(std::vector<size_t> &selectedC){
  * RETURN: standard selected vertex bitmap of the cell
  */
 unsigned char Mesh::getVbitmap(size_t cIdx){
-    unsigned char Vbitmap = cellInfoMap.at(cIdx).Vbitmap;
+    return getStandardVbitmap(cellInfoMap.at(cIdx).Vbitmap);
+}
+
+/*
+ * getStandardVbitmap()
+ * DESCRIPTION: get standard selected vertex bitmap of a selected vertex bitmap,
+ *              the selection of a mesh is standard when every cell has its standard bitmap
+ * INPUT: Vbitmap - selected vertex bitmap of a cell, bit i for the vertex i of the cell
+ * OUTPUT: standard selected vertex bitmap
+ * RETURN: standard selected vertex bitmap
+ */
+unsigned char HexRefine::getStandardVbitmap(unsigned char Vbitmap){
     int Vnum = getBitNum(Vbitmap);
 
     switch(Vnum)
@@ -990,7 +1031,7 @@ void Mesh::replaceCellWithTemplate(size_t cIdx, unsigned char Vbitmap){
      */
     if(Vnum != HEX_SIZE){
         for(size_t idx = 0; idx < HEX_SIZE; idx++)
-            localc.push_back(c.at(Global2Local.at(Vbitmap)[idx]));
+            localc.at(idx) = c.at(Global2Local.at(Vbitmap)[idx]);
     }
 
     switch(Vnum)
@@ -1021,6 +1062,9 @@ void Mesh::replaceCellWithTemplate(size_t cIdx, unsigned char Vbitmap){
         default:
             break;
     }
+
+    /* cells added by the template are children of the replaced cell */
+    addedParent.resize(addedC.size(), cIdx);
 }
 
 /*
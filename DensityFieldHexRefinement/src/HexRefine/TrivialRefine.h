@@ -1,6 +1,7 @@
 #ifndef TRIVIAL_REFINE_H
 #define TRIVIAL_REFINE_H
 
+#include <array>
 #include <vector>
 #include <unordered_map>
 #include <algorithm>
@@ -18,7 +19,7 @@ namespace HexRefine
         POLYGON
     };
 
-    typedef std::vector<int> Cell;
+    typedef std::array<int, 8> Cell;
     typedef Eigen::Vector3d Vertex;
     typedef std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d>> Vertexes;
 
@@ -74,6 +75,9 @@ namespace HexRefine
         std::unordered_map<Edge, EdgeInfo> E;
         std::unordered_map<size_t, std::vector<size_t>> VI_CI; /* vertex id - cell id pair */
         std::unordered_map<size_t, CellInfo> cellInfoMap;
+        std::vector<int> CellOrigin; /* index of each cell before the last update, -1 for added cells */
+        std::vector<int> ChildOffset; /* children of cell p before the last update are ChildC[ChildOffset[p]] ~ ChildC[ChildOffset[p + 1] - 1] */
+        std::vector<int> ChildC;
         CellType cellType;
 
         Mesh(const Vertexes &v, const std::vector<Cell> &c, const CellType cellType);
@@ -98,6 +102,7 @@ namespace HexRefine
         std::vector<size_t> abandonedV;
         std::vector<Cell> addedC;
         std::vector<size_t> abandonedC;
+        std::vector<size_t> addedParent; /* index of the replaced cell of each added cell */
 
         void addModifiedEdgeTemplate(Cell c);
         void addModifiedFaceTemplate(Cell c);
@@ -112,6 +117,8 @@ namespace HexRefine
         int getAddedVertexIdx(Vertex v);
         void update(); /* for lazy evaluation */
     };
+
+    unsigned char getStandardVbitmap(unsigned char Vbitmap);
 }
 
 #endif
\ No newline at end of file
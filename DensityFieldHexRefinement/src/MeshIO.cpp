@@ -4,6 +4,16 @@ using namespace std;
 #include <string>
 #include <vector>
 #include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include <charconv>
+#include <zlib.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 
 #include <vtkPolyData.h>
 #include <vtkGenericDataObjectReader.h>
@@ -11,6 +21,11 @@ using namespace std;
 #include <vtkUnstructuredGridReader.h>
 #include <vtkOBJReader.h>
 #include <vtkCleanPolyData.h>
+#include <vtkXMLUnstructuredGridReader.h>
+#include <vtkCellArray.h>
+#include <vtkDoubleArray.h>
+#include <vtkIdTypeArray.h>
+#include <vtkVersion.h>
 
 #include <eigen3/Eigen/Eigen>
 
@@ -30,13 +45,494 @@ int meshReader(const char* fname, Matrix3Xd &V, MatrixXi &C)
 {
     string fstring(fname);
 
+    /* fall back to vtk library if the file is not supported by the native reader */
     if (fstring.find(".vtk") != fstring.npos)
-        vtkReader(fname, V, C);
+    {
+        if (vtkHexReader(fname, V, C) == -1)
+            vtkReader(fname, V, C);
+    }
+    else if (fstring.find(".vtu") != fstring.npos)
+        vtuReader(fname, V, C);
+    else if (fstring.find(".hmc") != fstring.npos)
+        return cacheReader(fname, V, C);
     else
         return -1;
     return 0;
 }
 
+/*
+ * cacheReader()
+ * DESCRIPTION: read hex mesh from mesh cache file
+ * INPUT: fname - input filenme
+ * OUTPUT: V, C - mesh
+ * RETURN: -1 if fail, 0 if success
+ */
+int cacheReader(const char* fname, Matrix3Xd &V, MatrixXi &C)
+{
+    MeshCache cache;
+    if (cacheOpen(fname, cache) == -1)
+        return -1;
+    V = cache.getV();
+    C = cache.getC();
+    return 0;
+}
+
+/* whether the checksum of the whole mesh cache is verified, see setCacheVerify() */
+static bool cacheVerify = false;
+
+/*
+ * setCacheVerify()
+ * DESCRIPTION: choose whether cacheOpen() verifies the checksum of the whole file, which reads every page
+ * INPUT: verify - true to verify the whole file, false to verify the header & array table only
+ * OUTPUT: none
+ * RETURN: none
+ */
+void setCacheVerify(bool verify)
+{
+    cacheVerify = verify;
+}
+
+/*
+ * cacheOpen()
+ * DESCRIPTION: map a mesh cache file, its vertexes & cells are used in place by cache.getV() & cache.getC()
+ * INPUT: fname - input filenme
+ * OUTPUT: cache - mapped mesh cache
+ * RETURN: -1 if fail, 0 if success
+ */
+int cacheOpen(const char* fname, MeshCache &cache)
+{
+    if (cache.open(fname, cacheVerify) == -1)
+        return -1;
+    cout << "MeshCache: " << cache.vertNum() << " points " << cache.cellNum() << " cells" << endl;
+    return 0;
+}
+
+/*
+ * MappedFile
+ * DESCRIPTION: read-only view of a whole file, mapped into memory except on windows where it is read into a buffer
+ */
+class MappedFile
+{
+public:
+    const char *data;
+    size_t size;
+
+    MappedFile(const char *fname) : data(NULL), size(0)
+    {
+#ifndef _WIN32
+        const int fd = ::open(fname, O_RDONLY);
+        struct stat st;
+        if (fd == -1)
+            return;
+        if (fstat(fd, &st) == 0 && st.st_size > 0)
+        {
+            void *addr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (addr != MAP_FAILED)
+            {
+                data = (const char *)addr;
+                size = st.st_size;
+            }
+        }
+        ::close(fd);
+#else
+        ifstream ifs(fname, ios::binary);
+        buf.assign(istreambuf_iterator<char>(ifs), istreambuf_iterator<char>());
+        data = buf.data();
+        size = buf.size();
+#endif
+    }
+
+    ~MappedFile()
+    {
+#ifndef _WIN32
+        if (data)
+            munmap((void *)data, size);
+#endif
+    }
+
+private:
+    vector<char> buf;
+
+    MappedFile(const MappedFile &);
+    MappedFile &operator=(const MappedFile &);
+};
+
+static inline bool isSpace(char c)
+{
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+/*
+ * readLine()
+ * DESCRIPTION: read the next non-empty line of a vtk file
+ * INPUT: p - current position
+ *        end - end of the file
+ * OUTPUT: p - position after the line
+ *         line - the line without line break
+ * RETURN: false if the end of file is reached
+ */
+static bool readLine(const char *&p, const char *end, string &line)
+{
+    while (p < end && isSpace(*p))
+        p++;
+    if (p == end)
+        return false;
+    const char *eol = (const char *)memchr(p, '\n', end - p);
+    if (eol == NULL)
+        eol = end;
+    line.assign(p, eol);
+    if (!line.empty() && line.back() == '\r')
+        line.pop_back();
+    p = (eol == end) ? end : eol + 1;
+    return true;
+}
+
+/*
+ * findSection()
+ * DESCRIPTION: find the end of an ascii section, i.e. the next line starting with a keyword
+ * INPUT: p - start of the section
+ *        end - end of the file
+ * OUTPUT: none
+ * RETURN: start of the next keyword, or end of the file
+ */
+static const char *findSection(const char *p, const char *end)
+{
+    while ((p = (const char *)memchr(p, '\n', end - p)) != NULL)
+    {
+        p++;
+        if (p < end && *p >= 'A' && *p <= 'Z')
+            return p;
+    }
+    return end;
+}
+
+/*
+ * sectionCapacity()
+ * DESCRIPTION: bound the number of values a section could hold, each ascii value takes at least a digit and
+ *              a separator, so counts of a header are checked against the file before anything is allocated
+ * INPUT: p - start of the section
+ *        e - end of the section
+ *        binary - whether values are binary
+ *        typeSize - size of a binary value
+ * OUTPUT: none
+ * RETURN: maximum number of values in [p, e)
+ */
+static size_t sectionCapacity(const char *p, const char *e, bool binary, size_t typeSize)
+{
+    return binary ? (e - p) / typeSize : (e - p + 1) / 2;
+}
+
+/*
+ * parseAscii()
+ * DESCRIPTION: parse whitespace separated numbers of [begin, end) in parallel using from_chars,
+ *              the text is split into chunks at whitespaces, numbers of each chunk are counted first so that
+ *              every chunk knows the index of its first number
+ * INPUT: begin, end - text
+ *        num - expected number of numbers
+ *        store - store(i, value) is called with the ith number, returns false if the value is invalid
+ * OUTPUT: none
+ * RETURN: 0 if success, -1 if the count does not match or a number is ill-formed
+ */
+template <class T, class Store>
+static int parseAscii(const char *begin, const char *end, size_t num, Store store)
+{
+    const size_t chunkSize = 1 << 20;
+    const int chunkNum = (end - begin) / chunkSize + 1;
+    vector<const char *> bound(chunkNum + 1, end);
+    vector<size_t> offset(chunkNum + 1, 0);
+    bound.at(0) = begin;
+    for (int k = 1; k < chunkNum; k++)
+    {
+        const char *p = max(bound.at(k - 1), begin + k * chunkSize);
+        while (p < end && !isSpace(*p))
+            p++;
+        bound.at(k) = p;
+    }
+
+    /* count numbers of each chunk */
+#pragma omp parallel for schedule(dynamic)
+    for (int k = 0; k < chunkNum; k++)
+    {
+        size_t count = 0;
+        for (const char *p = bound.at(k), *e = bound.at(k + 1); p < e;)
+        {
+            while (p < e && isSpace(*p))
+                p++;
+            if (p == e)
+                break;
+            count++;
+            while (p < e && !isSpace(*p))
+                p++;
+        }
+        offset.at(k + 1) = count;
+    }
+    for (int k = 0; k < chunkNum; k++)
+        offset.at(k + 1) += offset.at(k);
+    if (offset.at(chunkNum) != num)
+        return -1;
+
+    /* parse */
+    int failed = 0;
+#pragma omp parallel for schedule(dynamic) reduction(| : failed)
+    for (int k = 0; k < chunkNum; k++)
+    {
+        size_t i = offset.at(k);
+        for (const char *p = bound.at(k), *e = bound.at(k + 1); p < e && !failed;)
+        {
+            while (p < e && isSpace(*p))
+                p++;
+            if (p == e)
+                break;
+            T value;
+            const from_chars_result r = from_chars(p, e, value);
+            if (r.ec != errc() || (r.ptr < e && !isSpace(*r.ptr)) || !store(i++, value))
+                failed = 1;
+            p = r.ptr;
+        }
+    }
+    return failed ? -1 : 0;
+}
+
+/*
+ * parseBinary()
+ * DESCRIPTION: parse big endian numbers of a binary section in parallel
+ * INPUT: begin - start of the section
+ *        num - number of numbers
+ *        store - store(i, value) is called with the ith number, returns false if the value is invalid
+ * OUTPUT: none
+ * RETURN: 0 if success, -1 if a value is invalid
+ */
+template <class T, class Store>
+static int parseBinary(const char *begin, size_t num, Store store)
+{
+    const uint16_t one = 1;
+    const bool swap = (*(const char *)&one == 1);
+    int failed = 0;
+#pragma omp parallel for reduction(| : failed)
+    for (long long i = 0; i < (long long)num; i++)
+    {
+        char bytes[sizeof(T)];
+        memcpy(bytes, begin + i * sizeof(T), sizeof(T));
+        if (swap)
+            reverse(bytes, bytes + sizeof(T));
+        T value;
+        memcpy(&value, bytes, sizeof(T));
+        if (!store(i, value))
+            failed = 1;
+    }
+    return failed ? -1 : 0;
+}
+
+/*
+ * vtkHexReader()
+ * DESCRIPTION: read hex mesh from legacy vtk file (ascii or binary) without vtk library,
+ *              the file is memory-mapped and POINTS, CELLS & CELL_TYPES are parsed in parallel directly into V & C
+ * INPUT: fname - input filenme
+ *        mesh - reference to the mesh to be load
+ * OUTPUT: mesh
+ * RETURN: -1 if the file is not supported (not an unstructured grid of hex cells, or other sections before cells),
+ *         0 if success
+ */
+int vtkHexReader(const char* fname, Matrix3Xd &V, MatrixXi &C)
+{
+    MappedFile file(fname);
+    if (file.data == NULL)
+        return -1;
+    const char *p = file.data, *end = file.data + file.size;
+    string line, keyword, type;
+
+    /* header, title, format & dataset */
+    if (!readLine(p, end, line) || line.compare(0, 5, "# vtk"))
+        return -1;
+    if (!readLine(p, end, line) || !readLine(p, end, line))
+        return -1;
+    const bool binary = (line.compare(0, 6, "BINARY") == 0);
+    if (!binary && line.compare(0, 5, "ASCII"))
+        return -1;
+    if (!readLine(p, end, line) || line.find("UNSTRUCTURED_GRID") == line.npos)
+        return -1;
+
+    long long vnum = -1, cnum = -1, typeNum = -1;
+    while ((vnum == -1 || cnum == -1 || typeNum == -1) && readLine(p, end, line))
+    {
+        istringstream iss(line);
+        iss >> keyword;
+        if (keyword == "POINTS")
+        {
+            if (!(iss >> vnum >> type) || vnum < 0 || (type != "float" && type != "double"))
+                return -1;
+            const size_t typeSize = (type == "float") ? sizeof(float) : sizeof(double);
+            const char *e = binary ? end : findSection(p, end);
+            /* the section must hold all coordinates before V is allocated */
+            if ((unsigned long long)vnum > sectionCapacity(p, e, binary, typeSize) / 3)
+                return -1;
+            V.resize(3, vnum);
+            double *data = V.data();
+            auto store = [data](size_t i, double x) { data[i] = x; return true; };
+            int ret;
+            if (binary)
+            {
+                ret = (type == "float") ? parseBinary<float>(p, 3 * vnum, store) : parseBinary<double>(p, 3 * vnum, store);
+                p += 3 * vnum * typeSize;
+            }
+            else
+            {
+                ret = parseAscii<double>(p, e, 3 * vnum, store);
+                p = e;
+            }
+            if (ret == -1)
+                return -1;
+        }
+        else if (keyword == "CELLS")
+        {
+            long long size;
+            if (!(iss >> cnum >> size) || cnum < 0 || size < 0)
+                return -1;
+            const char *e = binary ? end : findSection(p, end);
+            /* the section must hold all indexes before C is allocated */
+            if ((unsigned long long)size > sectionCapacity(p, e, binary, sizeof(int32_t)) || cnum > size || size != (HEX_SIZE + 1) * cnum)
+                return -1;
+            C.resize(HEX_SIZE, cnum);
+            int *data = C.data();
+            /* each cell is the number of its vertexes followed by vertex indexes */
+            auto store = [data](size_t i, int x)
+            {
+                const size_t j = i % (HEX_SIZE + 1);
+                if (j == 0)
+                    return x == HEX_SIZE;
+                data[i / (HEX_SIZE + 1) * HEX_SIZE + j - 1] = x;
+                return true;
+            };
+            int ret;
+            if (binary)
+            {
+                ret = parseBinary<int32_t>(p, size, store);
+                p += size * sizeof(int32_t);
+            }
+            else
+            {
+                ret = parseAscii<int>(p, e, size, store);
+                p = e;
+            }
+            if (ret == -1)
+                return -1;
+        }
+        else if (keyword == "CELL_TYPES")
+        {
+            if (!(iss >> typeNum) || typeNum != cnum)
+                return -1;
+            auto store = [](size_t, int x) { return x == VTK_HEXAHEDRON; };
+            int ret;
+            if (binary)
+            {
+                if (typeNum * sizeof(int32_t) > (size_t)(end - p))
+                    return -1;
+                ret = parseBinary<int32_t>(p, typeNum, store);
+            }
+            else
+                ret = parseAscii<int>(p, findSection(p, end), typeNum, store);
+            if (ret == -1)
+                return -1;
+        }
+        else
+            return -1;
+    }
+    if (vnum == -1 || cnum == -1 || typeNum == -1)
+        return -1;
+
+    /* vertex indexes must be in range */
+    for (long long i = 0; i < HEX_SIZE * cnum; i++)
+        if (C.data()[i] < 0 || C.data()[i] >= vnum)
+            return -1;
+
+    cout << "UnstructuredGrid: " << vnum << " points " << cnum << " cells" << endl;
+    return 0;
+}
+
+/*
+ * getCellArrays()
+ * DESCRIPTION: copy offsets & connectivity of all cells of a vtk cell array in one go,
+ *              vertexes of cell i are Conn[Offset[i]] ~ Conn[Offset[i + 1] - 1]
+ * INPUT: cells - vtk cell array
+ * OUTPUT: Offset, Conn - cells
+ * RETURN: none
+ */
+static void getCellArrays(vtkCellArray* cells, vector<vtkIdType> &Offset, vector<vtkIdType> &Conn)
+{
+#if VTK_MAJOR_VERSION >= 9
+    vtkSmartPointer<vtkIdTypeArray> offsets = vtkSmartPointer<vtkIdTypeArray>::New();
+    vtkSmartPointer<vtkIdTypeArray> conn = vtkSmartPointer<vtkIdTypeArray>::New();
+    offsets->DeepCopy(cells->GetOffsetsArray());
+    conn->DeepCopy(cells->GetConnectivityArray());
+    Offset.assign(offsets->GetPointer(0), offsets->GetPointer(0) + offsets->GetNumberOfValues());
+    Conn.assign(conn->GetPointer(0), conn->GetPointer(0) + conn->GetNumberOfValues());
+#else
+    /* legacy layout, number of vertexes of each cell followed by its vertexes */
+    const vtkIdType* data = cells->GetData()->GetPointer(0);
+    const vtkIdType size = cells->GetData()->GetNumberOfValues();
+    Offset.assign(1, 0);
+    Conn.clear();
+    Conn.reserve(size);
+    for (vtkIdType i = 0; i < size; i += data[i] + 1)
+    {
+        Conn.insert(Conn.end(), data + i + 1, data + i + 1 + data[i]);
+        Offset.push_back(Conn.size());
+    }
+#endif
+    if (Offset.empty())
+        Offset.push_back(0);
+}
+
+/*
+ * getPointArray()
+ * DESCRIPTION: copy coordinates of all points in one go
+ * INPUT: points - vtk points, could be NULL if there is no point
+ * OUTPUT: none
+ * RETURN: coordinates of points, x y z of each point
+ */
+static vtkSmartPointer<vtkDoubleArray> getPointArray(vtkPoints* points)
+{
+    vtkSmartPointer<vtkDoubleArray> coords = vtkSmartPointer<vtkDoubleArray>::New();
+    if (points != NULL)
+        coords->DeepCopy(points->GetData());
+    return coords;
+}
+
+/*
+ * readUnstructuredGrid()
+ * DESCRIPTION: read hex mesh from vtk unstructured grid, points and cells are copied from the arrays of the grid in bulk
+ * INPUT: grid - vtk unstructured grid
+ *        mesh - reference to the mesh to be load
+ * OUTPUT: mesh
+ * RETURN: none
+ */
+static void readUnstructuredGrid(vtkUnstructuredGrid* grid, Matrix3Xd &V, MatrixXi &C)
+{
+    const vtkIdType vnum = grid->GetNumberOfPoints();
+    const vtkIdType cnum = grid->GetNumberOfCells();
+    cout << "UnstructuredGrid: " << vnum << " points " << cnum << " cells" << endl;
+
+    /* read vertexes */
+    vtkSmartPointer<vtkDoubleArray> coords = getPointArray(grid->GetPoints());
+    V = Map<const Matrix3Xd>(coords->GetPointer(0), 3, vnum);
+
+    /* read cell type */
+    const vtkIdType cellType = grid->GetCellType(0);
+    if (cellType != VTK_HEXAHEDRON){
+        std::cout << "Not a Hex mesh" << std::endl;
+        return;
+    }
+
+    /* read cells */
+    vector<vtkIdType> Offset, Conn;
+    getCellArrays(grid->GetCells(), Offset, Conn);
+    if ((vtkIdType)Conn.size() != HEX_SIZE * cnum){
+        std::cout << "Not a Hex mesh" << std::endl;
+        return;
+    }
+    C = Map<const Matrix<vtkIdType, HEX_SIZE, Dynamic>>(Conn.data(), HEX_SIZE, cnum).cast<int>();
+}
+
 /*
  * vtkReader()
  * DESCRIPTION: read mesh from vtk file
@@ -54,109 +550,473 @@ void vtkReader(const char* fname, Matrix3Xd &V, MatrixXi &C)
 
     /* read unstructured grid */
     if (reader->IsFileUnstructuredGrid())
-    {
-        vtkUnstructuredGrid* output = reader->GetUnstructuredGridOutput();
-        const vtkIdType vnum = output->GetNumberOfPoints();
-        const vtkIdType cnum = output->GetNumberOfCells();
-        cout << "UnstructuredGrid: " << vnum << " points " << cnum << " cells" << endl;
-        V.resize(3, vnum);
+        readUnstructuredGrid(reader->GetUnstructuredGridOutput(), V, C);
+}
 
-        /* read vertexes */
-        double p[3];
-        for (vtkIdType i = 0; i < vnum; i++)
-        {
-            output->GetPoint(i, p);
-            V(0, i) = p[0];
-            V(1, i) = p[1];
-            V(2, i) = p[2];
-        }
+/*
+ * vtuReader()
+ * DESCRIPTION: read mesh from xml vtk unstructured grid file
+ * INPUT: fname - input filenme
+ *        mesh - reference to the mesh to be load
+ * OUTPUT: mesh
+ * RETURN: none
+ */
+void vtuReader(const char* fname, Matrix3Xd &V, MatrixXi &C)
+{
+    vtkSmartPointer<vtkXMLUnstructuredGridReader> reader = vtkSmartPointer<vtkXMLUnstructuredGridReader>::New();
+    reader->SetFileName(fname);
+    reader->Update();
+    readUnstructuredGrid(reader->GetOutput(), V, C);
+}
 
-        /* read cell type */
-        const vtkIdType cellType = output->GetCellType(0);
-        if (cellType != VTK_HEXAHEDRON){
-            std::cout << "Not a Hex mesh" << std::endl;
-            return;
-        }
+/* whether vtk files are written in binary, see setVtkBinary() */
+static bool vtkBinary = false;
+
+/*
+ * setVtkBinary()
+ * DESCRIPTION: choose the format of vtk files written by vtkWriter()
+ * INPUT: binary - true for legacy binary format, false for ascii
+ * OUTPUT: none
+ * RETURN: none
+ */
+void setVtkBinary(bool binary)
+{
+    vtkBinary = binary;
+}
+
+/*
+ * writeBigEndian()
+ * DESCRIPTION: write an array in one block, legacy vtk binary files are big endian
+ * INPUT: ofs - output stream opened in binary mode
+ *        data - array to be wrote
+ * OUTPUT: data followed by a new line
+ * RETURN: none
+ */
+template <class T>
+static void writeBigEndian(ofstream &ofs, const vector<T> &data)
+{
+    const uint16_t one = 1;
+    vector<char> buf(data.size() * sizeof(T));
+    memcpy(buf.data(), data.data(), buf.size());
+    if (*(const char *)&one == 1)
+        for (size_t i = 0; i < buf.size(); i += sizeof(T))
+            reverse(buf.begin() + i, buf.begin() + i + sizeof(T));
+    ofs.write(buf.data(), buf.size());
+    ofs << '\n';
+}
+
+/*
+ * writeChunks()
+ * DESCRIPTION: format lines [0, num) of an ascii section in parallel, lines are formatted in chunks into
+ *              buffers of their own, then the chunks are written in order with one write per chunk
+ * INPUT: ofs - output stream
+ *        num - number of lines
+ *        format - format(i, buf) appends line i to buf
+ * OUTPUT: formatted lines
+ * RETURN: none
+ */
+template <class Format>
+static void writeChunks(ofstream &ofs, size_t num, Format format)
+{
+    const size_t chunkSize = 1 << 14;  // lines per chunk
+    const size_t roundSize = 64;       // chunks held in memory at a time
+    const size_t chunkNum = (num + chunkSize - 1) / chunkSize;
+    vector<string> bufs(min(chunkNum, roundSize));
 
-        /* read cells */
-        C.resize(HEX_SIZE, cnum);
-        for (vtkIdType i = 0; i < cnum; i++)
+    for (size_t r = 0; r < chunkNum; r += roundSize)
+    {
+        const long long n = min(roundSize, chunkNum - r);
+#pragma omp parallel for schedule(dynamic)
+        for (long long k = 0; k < n; k++)
         {
-            vtkSmartPointer<vtkIdList> idList = vtkSmartPointer<vtkIdList>::New();
-            output->GetCellPoints(i, idList);
-            const vtkIdType csize = idList->GetNumberOfIds();
-            for (vtkIdType j = 0; j < csize; j++)
-                C(j, i) = idList->GetId(j);
+            string &buf = bufs.at(k);
+            const size_t begin = (r + k) * chunkSize, end = min(num, begin + chunkSize);
+            buf.clear();
+            buf.reserve(chunkSize * 64);
+            for (size_t i = begin; i < end; i++)
+                format(i, buf);
         }
+        for (long long k = 0; k < n; k++)
+            ofs.write(bufs.at(k).data(), bufs.at(k).size());
     }
 }
 
+/* append numbers to a buffer, formatted the same as ostream, i.e. printf in C locale */
+static inline void appendInt(string &buf, long long x)
+{
+    char s[24];
+    buf.append(s, to_chars(s, s + sizeof(s), x).ptr);
+}
+
+/* same as ostream << fixed << setprecision(precision) */
+static inline void appendFixed(string &buf, double x, int precision)
+{
+    char s[400];
+    buf.append(s, to_chars(s, s + sizeof(s), x, chars_format::fixed, precision).ptr);
+}
+
+/* same as ostream with default format */
+static inline void appendGeneral(string &buf, double x)
+{
+    char s[32];
+    buf.append(s, to_chars(s, s + sizeof(s), x, chars_format::general, 6).ptr);
+}
+
 /*
- * vtkWriter()
- * DESCRIPTION: write mesh into vtk file
- * INPUT: fname - output filenme
- *        mesh - reference to the mesh to be wrote
- * OUTPUT: vtk file
+ * writeGrid()
+ * DESCRIPTION: write header, vertexes & cells of a vtk file, in ascii or binary format, see setVtkBinary()
+ * INPUT: ofs - output stream opened in binary mode
+ *        fname - output filenme, used as the title
+ *        V, C - mesh
+ * OUTPUT: vtk unstructured grid without data arrays
  * RETURN: none
  */
-void vtkWriter(const char* fname, const Matrix3Xd &V, const MatrixXi &C)
+static void writeGrid(ofstream &ofs, const char* fname, const Ref<const Matrix3Xd> &V, const Ref<const MatrixXi> &C)
 {
     const size_t vnum = V.cols();
     const size_t cnum = C.cols();
 
-    ofstream ofs(fname);
     /* write standart format */
-    ofs << "# vtk DataFile Version 2.0" << endl
-        << fname << endl
-        << "ASCII" << endl << endl
-        << "DATASET UNSTRUCTURED_GRID" << endl;
+    ofs << "# vtk DataFile Version 2.0\n"
+        << fname << "\n"
+        << (vtkBinary ? "BINARY" : "ASCII") << "\n\n"
+        << "DATASET UNSTRUCTURED_GRID\n";
 
     /* write vertexes */
-    ofs << "POINTS " << vnum << " float" << endl;
-    for (size_t i = 0; i < vnum; i++)
-        ofs << fixed << setprecision(7) << V(0, i) << " " << V(1, i) << " " << V(2, i) << endl;
+    ofs << "POINTS " << vnum << " float\n";
+    if (vtkBinary)
+    {
+        vector<float> P(3 * vnum);
+        for (size_t i = 0; i < vnum; i++)
+            for (int j = 0; j < 3; j++)
+                P.at(3 * i + j) = V(j, i);
+        writeBigEndian(ofs, P);
+    }
+    else
+        writeChunks(ofs, vnum, [&](size_t i, string &buf)
+                    {
+            for (int j = 0; j < 3; j++)
+            {
+                appendFixed(buf, V(j, i), 7);
+                buf += (j < 2) ? ' ' : '\n';
+            } });
 
     /* write cellType */
     ofs << "CELLS " << cnum << " ";
     vtkIdType idType = VTK_HEXAHEDRON;
-    ofs << 9*cnum << endl;
+    ofs << 9*cnum << "\n";
 
     /* write cells */
-    for (size_t i = 0; i < cnum; i++){
-        ofs << HEX_SIZE;
+    if (vtkBinary)
+    {
+        vector<int32_t> cells(9 * cnum);
+        for (size_t i = 0; i < cnum; i++)
+        {
+            cells.at(9 * i) = HEX_SIZE;
+            for (size_t j = 0; j < HEX_SIZE; j++)
+                cells.at(9 * i + j + 1) = C(j, i);
+        }
+        writeBigEndian(ofs, cells);
+        ofs << "CELL_TYPES " << cnum << "\n";
+        writeBigEndian(ofs, vector<int32_t>(cnum, idType));
+        return;
+    }
+
+    writeChunks(ofs, cnum, [&](size_t i, string &buf)
+                {
+        appendInt(buf, HEX_SIZE);
         for (size_t j = 0; j < HEX_SIZE; j++)
-            ofs << " " << C(j, i);
-        ofs << endl;
+        {
+            buf += ' ';
+            appendInt(buf, C(j, i));
+        }
+        buf += '\n'; });
+    ofs << "CELL_TYPES " << cnum << "\n";
+    writeChunks(ofs, cnum, [&](size_t, string &buf)
+                {
+        appendInt(buf, idType);
+        buf += '\n'; });
+}
+
+/*
+ * writeArrays()
+ * DESCRIPTION: write the arrays of one location as a CELL_DATA or POINT_DATA section, one SCALARS per array,
+ *              doubles are written as float as in the other vtk files
+ * INPUT: ofs - output stream opened in binary mode
+ *        location - CACHE_CELL_DATA or CACHE_POINT_DATA, arrays of the other location are skipped
+ *        num - number of cells or vertexes
+ *        arrays - named arrays, see CacheArray
+ * OUTPUT: data section, nothing if no array is at the location
+ * RETURN: none
+ */
+static void writeArrays(ofstream &ofs, CacheLocation location, size_t num, const vector<CacheArray> &arrays)
+{
+    bool section = false;
+    for (const CacheArray &array : arrays)
+    {
+        if (array.location != location)
+            continue;
+        if (!section)
+        {
+            ofs << ((location == CACHE_CELL_DATA) ? "CELL_DATA " : "POINT_DATA ") << num << "\n";
+            section = true;
+        }
+        const int comp = array.components;
+        ofs << "SCALARS " << array.name << ((array.type == CACHE_FLOAT64) ? " float " : " int ") << comp << "\n"
+            << "LOOKUP_TABLE default\n";
+
+        if (array.type == CACHE_FLOAT64)
+        {
+            const double *data = (const double *)array.data;
+            if (vtkBinary)
+                writeBigEndian(ofs, vector<float>(data, data + num * comp));
+            else
+                writeChunks(ofs, num, [&](size_t i, string &buf)
+                            {
+                    for (int j = 0; j < comp; j++)
+                    {
+                        appendGeneral(buf, data[i * comp + j]);
+                        buf += (j + 1 < comp) ? ' ' : '\n';
+                    } });
+        }
+        else
+        {
+            const int32_t *data = (const int32_t *)array.data;
+            if (vtkBinary)
+                writeBigEndian(ofs, vector<int32_t>(data, data + num * comp));
+            else
+                writeChunks(ofs, num, [&](size_t i, string &buf)
+                            {
+                    for (int j = 0; j < comp; j++)
+                    {
+                        appendInt(buf, data[i * comp + j]);
+                        buf += (j + 1 < comp) ? ' ' : '\n';
+                    } });
+        }
     }
-    ofs << "CELL_TYPES " << cnum << endl;
-    for (size_t i = 0; i < cnum; i++)
-        ofs << idType << endl;
 }
 
-void vtkWriter(const char* fname, const Matrix3Xd &V, const MatrixXi &C, std::vector<double> Scalar)
+/*
+ * vtkWriter()
+ * DESCRIPTION: write mesh into vtk file, in ascii or binary format, see setVtkBinary()
+ *              the mesh is written once, followed by any number of named cell & vertex arrays
+ * INPUT: fname - output filenme
+ *        V, C - mesh
+ *        arrays - named arrays, see CacheArray
+ * OUTPUT: vtk file
+ * RETURN: none
+ */
+void vtkWriter(const char* fname, const Ref<const Matrix3Xd> &V, const Ref<const MatrixXi> &C, const std::vector<CacheArray> &arrays)
+{
+    ofstream ofs(fname, ios::binary);
+    writeGrid(ofs, fname, V, C);
+    writeArrays(ofs, CACHE_CELL_DATA, C.cols(), arrays);
+    writeArrays(ofs, CACHE_POINT_DATA, V.cols(), arrays);
+}
+
+void vtkWriter(const char* fname, const Ref<const Matrix3Xd> &V, const Ref<const MatrixXi> &C)
+{
+    vtkWriter(fname, V, C, std::vector<CacheArray>());
+}
+
+void vtkWriter(const char* fname, const Ref<const Matrix3Xd> &V, const Ref<const MatrixXi> &C, std::vector<double> Scalar)
+{
+    CacheArray array = {"scalars", CACHE_CELL_DATA, CACHE_FLOAT64, 1, Scalar.data()};
+    vtkWriter(fname, V, C, std::vector<CacheArray>(1, array));
+}
+
+void vtkWriter(const char* fname, const Ref<const Matrix3Xd> &V, const Ref<const MatrixXi> &C, std::vector<int> Scalar)
 {
-    vtkWriter(fname, V, C);
-    std::ofstream f(fname, std::ios_base::app);
-    f << "CELL_DATA " << C.cols() << std::endl
-            << "SCALARS scalars float 1" << std::endl
-            << "LOOKUP_TABLE default" << std::endl;
-    for (size_t i = 0; i < Scalar.size(); i++)
+    CacheArray array = {"scalars", CACHE_CELL_DATA, CACHE_INT32, 1, Scalar.data()};
+    vtkWriter(fname, V, C, std::vector<CacheArray>(1, array));
+}
+
+/*
+ * compressArray()
+ * DESCRIPTION: compress an array for the appended data of a vtu file, the array is split into blocks
+ *              which are compressed by zlib in parallel, fastest level as the size is close to the default level
+ * INPUT: data, size - bytes of the array
+ * OUTPUT: out - UInt64 header (number of blocks, block size, size of the last partial block, compressed size of
+ *               each block) followed by the compressed blocks
+ * RETURN: 0 if success, -1 if failed
+ */
+static int compressArray(const void *data, size_t size, string &out)
+{
+    const size_t blockSize = 1 << 20;
+    const size_t blockNum = (size + blockSize - 1) / blockSize;
+    vector<string> blocks(blockNum);
+    vector<int> status(blockNum);
+
+#pragma omp parallel for schedule(dynamic)
+    for (long long k = 0; k < (long long)blockNum; k++)
     {
-        f << Scalar.at(i) << std::endl;
+        const size_t begin = k * blockSize, n = min(blockSize, size - begin);
+        uLongf len = compressBound(n);
+        blocks.at(k).resize(len);
+        status.at(k) = compress2((Bytef *)&blocks.at(k)[0], &len, (const Bytef *)data + begin, n, Z_BEST_SPEED);
+        blocks.at(k).resize(len);
     }
-    f.close();
+    for (int code : status)
+        if (code != Z_OK)
+            return -1;
+
+    vector<uint64_t> header(3 + blockNum);
+    header.at(0) = blockNum;
+    header.at(1) = blockSize;
+    header.at(2) = size % blockSize;
+    for (size_t k = 0; k < blockNum; k++)
+        header.at(3 + k) = blocks.at(k).size();
+    out.assign((const char *)header.data(), header.size() * sizeof(uint64_t));
+    for (const string &block : blocks)
+        out += block;
+    return 0;
 }
 
-void vtkWriter(const char* fname, const Matrix3Xd &V, const MatrixXi &C, std::vector<int> Scalar)
+/*
+ * vtuWriter()
+ * DESCRIPTION: write mesh & named arrays into xml vtk unstructured grid file, all arrays are zlib compressed
+ *              raw appended data in native byte order
+ * INPUT: fname - output filenme
+ *        V, C - mesh
+ *        arrays - named cell & vertex arrays, see CacheArray
+ * OUTPUT: vtu file
+ * RETURN: -1 if an array cannot be compressed or the file cannot be written, nothing is written then, 0 if success
+ */
+int vtuWriter(const char* fname, const Ref<const Matrix3Xd> &V, const Ref<const MatrixXi> &C, const std::vector<CacheArray> &arrays)
 {
-    vtkWriter(fname, V, C);
-    std::ofstream f(fname, std::ios_base::app);
-    f << "CELL_DATA " << C.cols() << std::endl
-            << "SCALARS scalars int 1" << std::endl
-            << "LOOKUP_TABLE default" << std::endl;
-    for (size_t i = 0; i < Scalar.size(); i++)
+    const size_t vnum = V.cols();
+    const size_t cnum = C.cols();
+    /* arrays are written straight from the matrices, copy only if they are not contiguous */
+    const Matrix3Xd VCopy = (V.outerStride() == 3) ? Matrix3Xd() : Matrix3Xd(V);
+    const MatrixXi CCopy = (C.outerStride() == HEX_SIZE) ? MatrixXi() : MatrixXi(C);
+    const double *P = (V.outerStride() == 3) ? V.data() : VCopy.data();
+    const int *Conn = (C.outerStride() == HEX_SIZE) ? C.data() : CCopy.data();
+
+    vector<int64_t> Offset(cnum);
+    for (size_t i = 0; i < cnum; i++)
+        Offset.at(i) = HEX_SIZE * (i + 1);
+    const vector<uint8_t> Type(cnum, VTK_HEXAHEDRON);
+
+    /* compress all arrays first, offsets of the appended data are written in the xml part */
+    struct Appended
+    {
+        string xml;
+        string data;
+    };
+    vector<Appended> PointData, CellData, Points(1), Cells(3);
+    bool failed = false;
+    auto pack = [&](Appended &a, const void *data, size_t size)
     {
-        f << Scalar.at(i) << std::endl;
+        if (!failed && compressArray(data, size, a.data) == -1)
+            failed = true;
+    };
+    for (const CacheArray &array : arrays)
+    {
+        const size_t num = (array.location == CACHE_CELL_DATA) ? cnum : vnum;
+        const bool isDouble = (array.type == CACHE_FLOAT64);
+        Appended a;
+        a.xml = string("<DataArray type=\"") + (isDouble ? "Float64" : "Int32") + "\" Name=\"" + array.name +
+                "\" NumberOfComponents=\"" + to_string(array.components) + "\" format=\"appended\"";
+        pack(a, array.data, num * array.components * (isDouble ? sizeof(double) : sizeof(int32_t)));
+        ((array.location == CACHE_CELL_DATA) ? CellData : PointData).push_back(std::move(a));
+    }
+    Points.at(0).xml = "<DataArray type=\"Float64\" NumberOfComponents=\"3\" format=\"appended\"";
+    Cells.at(0).xml = "<DataArray type=\"Int32\" Name=\"connectivity\" format=\"appended\"";
+    Cells.at(1).xml = "<DataArray type=\"Int64\" Name=\"offsets\" format=\"appended\"";
+    Cells.at(2).xml = "<DataArray type=\"UInt8\" Name=\"types\" format=\"appended\"";
+    pack(Points.at(0), P, 3 * vnum * sizeof(double));
+    pack(Cells.at(0), Conn, HEX_SIZE * cnum * sizeof(int));
+    pack(Cells.at(1), Offset.data(), cnum * sizeof(int64_t));
+    pack(Cells.at(2), Type.data(), cnum);
+    if (failed)
+    {
+        cout << "failed to compress " << fname << endl;
+        return -1;
     }
-    f.close();
+
+    /* xml part */
+    ofstream ofs(fname, ios::binary);
+    if (!ofs)
+    {
+        cout << "cannot open file " << fname << endl;
+        return -1;
+    }
+    const uint16_t one = 1;
+    uint64_t offset = 0;
+    auto writeXml = [&](const vector<Appended> &list)
+    {
+        for (const Appended &a : list)
+        {
+            ofs << "        " << a.xml << " offset=\"" << offset << "\"/>\n";
+            offset += a.data.size();
+        }
+    };
+    ofs << "<?xml version=\"1.0\"?>\n"
+        << "<VTKFile type=\"UnstructuredGrid\" version=\"1.0\" byte_order=\"" << ((*(const char *)&one == 1) ? "LittleEndian" : "BigEndian")
+        << "\" header_type=\"UInt64\" compressor=\"vtkZLibDataCompressor\">\n"
+        << "  <UnstructuredGrid>\n"
+        << "    <Piece NumberOfPoints=\"" << vnum << "\" NumberOfCells=\"" << cnum << "\">\n";
+    ofs << "      <PointData>\n";
+    writeXml(PointData);
+    ofs << "      </PointData>\n"
+        << "      <CellData>\n";
+    writeXml(CellData);
+    ofs << "      </CellData>\n"
+        << "      <Points>\n";
+    writeXml(Points);
+    ofs << "      </Points>\n"
+        << "      <Cells>\n";
+    writeXml(Cells);
+    ofs << "      </Cells>\n"
+        << "    </Piece>\n"
+        << "  </UnstructuredGrid>\n";
+
+    /* appended data, in the same order as the offsets */
+    ofs << "  <AppendedData encoding=\"raw\">\n   _";
+    for (const vector<Appended> *list : {&PointData, &CellData, &Points, &Cells})
+        for (const Appended &a : *list)
+            ofs.write(a.data.data(), a.data.size());
+    ofs << "\n  </AppendedData>\n"
+        << "</VTKFile>\n";
+    ofs.close();
+    if (!ofs)
+    {
+        cout << "failed to write " << fname << endl;
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * meshWriter()
+ * DESCRIPTION: write mesh & named arrays into a mesh cache file if fname ends with .hmc,
+ *              a compressed vtu file if fname ends with .vtu, otherwise into a vtk file
+ * INPUT: fname - output filename
+ *        V, C - mesh
+ *        arrays - named cell & vertex arrays, see CacheArray
+ * OUTPUT: mesh file
+ * RETURN: -1 if fail, 0 if success
+ */
+int meshWriter(const char* fname, const Ref<const Matrix3Xd> &V, const Ref<const MatrixXi> &C, const std::vector<CacheArray> &arrays)
+{
+    if (hasExtension(fname, ".hmc"))
+        return writeMeshCache(fname, V, C, arrays);
+    else if (hasExtension(fname, ".vtu"))
+        return vtuWriter(fname, V, C, arrays);
+    vtkWriter(fname, V, C, arrays);
+    return 0;
+}
+
+/*
+ * hasExtension()
+ * DESCRIPTION: check whether a file name ends with an extension, used to choose the format of an output
+ * INPUT: fname - file name
+ *        ext - extension including the dot, e.g. ".vtu"
+ * OUTPUT: none
+ * RETURN: true if fname ends with ext
+ */
+bool hasExtension(const std::string &fname, const char *ext)
+{
+    const size_t n = strlen(ext);
+    return fname.size() >= n && fname.compare(fname.size() - n, n, ext) == 0;
 }
@@ -2,13 +2,24 @@
 #define MESH_IO_H
 
 #include <eigen3/Eigen/Eigen>
+#include "MeshCache.h"
 using namespace Eigen;
 
 int meshReader(const char* fname, Matrix3Xd &V, MatrixXi &C);
+int vtkHexReader(const char* fname, Matrix3Xd &V, MatrixXi &C);
+int cacheReader(const char* fname, Matrix3Xd &V, MatrixXi &C);
+int cacheOpen(const char* fname, MeshCache &cache);
+void setCacheVerify(bool verify);
 void vtkReader(const char* fname, Matrix3Xd &V, MatrixXi &C);
+void vtuReader(const char* fname, Matrix3Xd &V, MatrixXi &C);
 void objReader(const char* fname, Matrix3Xd &V, MatrixXi &C);
-void vtkWriter(const char* fname, const Matrix3Xd &V, const MatrixXi &C);
-void vtkWriter(const char* fname, const Matrix3Xd &V, const MatrixXi &C, std::vector<double> Scalar);
-void vtkWriter(const char* fname, const Matrix3Xd &V, const MatrixXi &C, std::vector<int> Scalar);
+void setVtkBinary(bool binary);
+void vtkWriter(const char* fname, const Ref<const Matrix3Xd> &V, const Ref<const MatrixXi> &C);
+void vtkWriter(const char* fname, const Ref<const Matrix3Xd> &V, const Ref<const MatrixXi> &C, std::vector<double> Scalar);
+void vtkWriter(const char* fname, const Ref<const Matrix3Xd> &V, const Ref<const MatrixXi> &C, std::vector<int> Scalar);
+void vtkWriter(const char* fname, const Ref<const Matrix3Xd> &V, const Ref<const MatrixXi> &C, const std::vector<CacheArray> &arrays);
+int vtuWriter(const char* fname, const Ref<const Matrix3Xd> &V, const Ref<const MatrixXi> &C, const std::vector<CacheArray> &arrays = std::vector<CacheArray>());
+int meshWriter(const char* fname, const Ref<const Matrix3Xd> &V, const Ref<const MatrixXi> &C, const std::vector<CacheArray> &arrays = std::vector<CacheArray>());
+bool hasExtension(const std::string &fname, const char *ext);
 
 #endif
@@ -0,0 +1,264 @@
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "MeshStore.h"
+
+static const char MeshStoreMagic[8] = {'D', 'F', 'H', 'R', 'M', 'E', 'S', 'H'};
+static const uint32_t MeshStoreVersion = 1;
+static const size_t MeshStoreHeaderSize = 32;
+
+/* constructor & destructor for class MeshStore */
+MeshStore::MeshStore() : data(NULL), size(0), vnum(0), cnum(0)
+{
+#ifdef _WIN32
+    file = mapping = NULL;
+#endif
+}
+
+MeshStore::~MeshStore()
+{
+    close();
+}
+
+/*
+ * open()
+ * DESCRIPTION: map a binary mesh file into memory
+ * INPUT: fname - binary mesh file name
+ * OUTPUT: mapped mesh
+ * RETURN: 0 if success, -1 if failed
+ */
+int MeshStore::open(const char *fname)
+{
+    close();
+
+#ifdef _WIN32
+    file = CreateFileA(fname, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        file = NULL;
+        std::cout << "cannot open file " << fname << std::endl;
+        return -1;
+    }
+    LARGE_INTEGER fsize;
+    GetFileSizeEx(file, &fsize);
+    size = fsize.QuadPart;
+    mapping = (size >= MeshStoreHeaderSize) ? CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL) : NULL;
+    data = mapping ? (const char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+#else
+    int fd = ::open(fname, O_RDONLY);
+    if (fd == -1)
+    {
+        std::cout << "cannot open file " << fname << std::endl;
+        return -1;
+    }
+    struct stat st;
+    fstat(fd, &st);
+    size = st.st_size;
+    if (size >= MeshStoreHeaderSize)
+    {
+        void *addr = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+        data = (addr == MAP_FAILED) ? NULL : (const char *)addr;
+    }
+    ::close(fd);
+#endif
+
+    if (data == NULL)
+    {
+        std::cout << "cannot map file " << fname << std::endl;
+        close();
+        return -1;
+    }
+
+    uint32_t version;
+    uint64_t header[2];
+    memcpy(&version, data + 8, sizeof(version));
+    memcpy(header, data + 16, sizeof(header));
+    if (memcmp(data, MeshStoreMagic, sizeof(MeshStoreMagic)) || version != MeshStoreVersion ||
+        size != MeshStoreHeaderSize + header[0] * 3 * sizeof(double) + header[1] * 8 * sizeof(int32_t))
+    {
+        std::cout << fname << " is not a binary mesh file of this version" << std::endl;
+        close();
+        return -1;
+    }
+    vnum = header[0];
+    cnum = header[1];
+    return 0;
+}
+
+/*
+ * close()
+ * DESCRIPTION: unmap the binary mesh file
+ * INPUT: none
+ * OUTPUT: none
+ * RETURN: none
+ */
+void MeshStore::close()
+{
+#ifdef _WIN32
+    if (data)
+        UnmapViewOfFile(data);
+    if (mapping)
+        CloseHandle(mapping);
+    if (file)
+        CloseHandle(file);
+    file = mapping = NULL;
+#else
+    if (data)
+        munmap((void *)data, size);
+#endif
+    data = NULL;
+    size = vnum = cnum = 0;
+}
+
+/* 3xd view of vertexes, each column is a vertex */
+Eigen::Map<const Eigen::Matrix3Xd> MeshStore::getV() const
+{
+    return Eigen::Map<const Eigen::Matrix3Xd>(vnum ? (const double *)(data + MeshStoreHeaderSize) : nullptr, 3, vnum);
+}
+
+/* 8xd view of cells, each column is a cell */
+Eigen::Map<const Eigen::MatrixXi> MeshStore::getC() const
+{
+    return Eigen::Map<const Eigen::MatrixXi>(cnum ? (const int *)(data + MeshStoreHeaderSize + vnum * 3 * sizeof(double)) : nullptr, 8, cnum);
+}
+
+/* constructor & destructor for class MeshStoreWriter */
+MeshStoreWriter::MeshStoreWriter() : vnum(0), cnum(0) {}
+
+MeshStoreWriter::~MeshStoreWriter()
+{
+    if (vfs.is_open())
+        close();
+}
+
+/*
+ * open()
+ * DESCRIPTION: start writing a binary mesh file, vertexes are written into a temporary file and cells into a side file
+ * INPUT: fname - binary mesh file name
+ * OUTPUT: none
+ * RETURN: 0 if success, -1 if failed
+ */
+int MeshStoreWriter::open(const char *fname)
+{
+    const char header[MeshStoreHeaderSize] = {0};
+
+    name = fname;
+    vnum = cnum = 0;
+    vfs.open(name + ".tmp", std::ios::binary | std::ios::trunc);
+    cfs.open(name + ".cells.tmp", std::ios::binary | std::ios::trunc);
+    if (!vfs || !cfs)
+    {
+        std::cout << "cannot open file " << name << ".tmp" << std::endl;
+        return -1;
+    }
+
+    /* header is written when closing */
+    vfs.write(header, sizeof(header));
+    return 0;
+}
+
+/*
+ * addVertex()
+ * DESCRIPTION: append a vertex
+ * INPUT: v - vertex
+ * OUTPUT: none
+ * RETURN: index of the vertex
+ */
+size_t MeshStoreWriter::addVertex(const Eigen::Vector3d &v)
+{
+    vfs.write((const char *)v.data(), 3 * sizeof(double));
+    return vnum++;
+}
+
+/*
+ * addCell()
+ * DESCRIPTION: append a cell
+ * INPUT: c - 8 vertex indexes of the cell
+ * OUTPUT: none
+ * RETURN: none
+ */
+void MeshStoreWriter::addCell(const HexCell &c)
+{
+    cfs.write((const char *)c.data(), sizeof(HexCell));
+    cnum++;
+}
+
+/*
+ * close()
+ * DESCRIPTION: append cells after vertexes, write the header and rename the temporary file
+ * INPUT: none
+ * OUTPUT: binary mesh file
+ * RETURN: 0 if success, -1 if failed
+ */
+int MeshStoreWriter::close()
+{
+    const std::string vName = name + ".tmp", cName = name + ".cells.tmp";
+    int ret = 0;
+
+    cfs.close();
+    {
+        std::ifstream ifs(cName, std::ios::binary);
+        if (cnum)
+            vfs << ifs.rdbuf();
+    }
+    std::remove(cName.c_str());
+
+    const uint64_t header[2] = {vnum, cnum};
+    vfs.seekp(0);
+    vfs.write(MeshStoreMagic, sizeof(MeshStoreMagic));
+    vfs.write((const char *)&MeshStoreVersion, sizeof(MeshStoreVersion));
+    vfs.seekp(16);
+    vfs.write((const char *)header, sizeof(header));
+    if (!vfs.flush())
+    {
+        std::cout << "failed to write file " << vName << std::endl;
+        ret = -1;
+    }
+    vfs.close();
+
+    std::remove(name.c_str());
+    if (ret == 0 && std::rename(vName.c_str(), name.c_str()))
+    {
+        std::cout << "failed to rename " << vName << " to " << name << std::endl;
+        ret = -1;
+    }
+    return ret;
+}
+
+/*
+ * writeMeshStore()
+ * DESCRIPTION: write a mesh into a binary mesh file
+ * INPUT: fname - binary mesh file name
+ *        V - 3xd matrix, each column is a vertex of a mesh
+ *        C - 8xd matrix, each column is a cell of a mesh, each cells contains 8 indexes of 8 vertexes in V
+ *            following vtk convention
+ * OUTPUT: binary mesh file
+ * RETURN: 0 if success, -1 if failed
+ */
+int writeMeshStore(const char *fname, const Eigen::Ref<const Eigen::Matrix3Xd> &V, const Eigen::Ref<const Eigen::MatrixXi> &C)
+{
+    MeshStoreWriter writer;
+    if (writer.open(fname) == -1)
+        return -1;
+
+    for (int i = 0; i < V.cols(); i++)
+        writer.addVertex(V.col(i));
+    for (int i = 0; i < C.cols(); i++)
+    {
+        HexCell c;
+        for (int j = 0; j < 8; j++)
+            c.at(j) = C(j, i);
+        writer.addCell(c);
+    }
+    return writer.close();
+}
@@ -0,0 +1,75 @@
+#ifndef MESH_STORE_H
+#define MESH_STORE_H
+
+#include <string>
+#include <fstream>
+#include <cstdint>
+#include <eigen3/Eigen/Eigen>
+
+#include "HexMesh.h"
+
+/*
+ * MeshStore
+ * DESCRIPTION: read-only hex mesh mapped from a binary mesh file, pages are loaded by the system on demand,
+ *              so a mesh larger than memory could be traversed through the 3xd & 8xd views
+ *              layout, native byte order
+ *                  char[8]  magic "DFHRMESH"
+ *                  uint32   version, uint32 reserved
+ *                  uint64   number of vertexes, uint64 number of cells
+ *                  double   3 coordinates of each vertex
+ *                  int32    8 vertex indexes of each cell
+ */
+class MeshStore
+{
+public:
+    MeshStore();
+    ~MeshStore();
+
+    int open(const char *fname);
+    void close();
+
+    size_t vertNum() const { return vnum; }
+    size_t cellNum() const { return cnum; }
+    Eigen::Map<const Eigen::Matrix3Xd> getV() const;
+    Eigen::Map<const Eigen::MatrixXi> getC() const;
+
+private:
+    const char *data;
+    size_t size;
+    size_t vnum, cnum;
+#ifdef _WIN32
+    void *file, *mapping;
+#endif
+
+    MeshStore(const MeshStore &);
+    MeshStore &operator=(const MeshStore &);
+};
+
+/*
+ * MeshStoreWriter
+ * DESCRIPTION: write a binary mesh file of MeshStore by appending vertexes & cells in any interleaving,
+ *              cells are buffered in a side file, the file is complete after close()
+ */
+class MeshStoreWriter
+{
+public:
+    MeshStoreWriter();
+    ~MeshStoreWriter();
+
+    int open(const char *fname);
+    int close();
+
+    size_t addVertex(const Eigen::Vector3d &v);
+    void addCell(const HexCell &c);
+    size_t vertNum() const { return vnum; }
+    size_t cellNum() const { return cnum; }
+
+private:
+    std::string name;
+    std::ofstream vfs, cfs;
+    uint64_t vnum, cnum;
+};
+
+int writeMeshStore(const char *fname, const Eigen::Ref<const Eigen::Matrix3Xd> &V, const Eigen::Ref<const Eigen::MatrixXi> &C);
+
+#endif
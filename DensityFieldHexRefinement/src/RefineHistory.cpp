@@ -0,0 +1,294 @@
+#include <algorithm>
+#include <unordered_map>
+
+#include "RefineHistory.h"
+
+/* constructor for class RefineHistory */
+RefineHistory::RefineHistory() : nextId(0) {}
+
+/*
+ * findRoot()
+ * DESCRIPTION: find the root of an element in a disjoint set, with path halving
+ * INPUT: root - parent of each element, the root is the parent of itself
+ *        i - element
+ * OUTPUT: halved paths
+ * RETURN: root of the element
+ */
+static int findRoot(std::vector<int> &root, int i)
+{
+    while (root.at(i) != i)
+    {
+        root.at(i) = root.at(root.at(i));
+        i = root.at(i);
+    }
+    return i;
+}
+
+/*
+ * getComponents()
+ * DESCRIPTION: group replaced cells of a level into components which have to be restored together,
+ *              i.e. replaced cells whose children share vertexes added by the refinement
+ *              a replaced cell is eligible if all its children are still in the mesh
+ * INPUT: level - refinement level
+ *        mesh - current mesh
+ *        IdIdx - index of the cell of each id in the current mesh, -1 if not in the mesh
+ * OUTPUT: root - root of the component of each replaced cell
+ *         eligible - whether all replaced cells of the component of each replaced cell are eligible
+ * RETURN: none
+ */
+static void getComponents(const RefineLevel &level, const HexMesh &mesh, const std::vector<int> &IdIdx,
+                          std::vector<int> &root, std::vector<bool> &eligible)
+{
+    const int pnum = level.ParentId.size();
+    std::unordered_map<int, int> AddedV; // vertex added by the refinement - a replaced cell containing it
+
+    root.resize(pnum);
+    for (int i = 0; i < pnum; i++)
+        root.at(i) = i;
+    std::vector<bool> present(pnum, true);
+
+    for (int i = 0; i < pnum; i++)
+    {
+        const HexCell &parent = level.ParentC.at(i);
+        for (int j = level.ChildOffset.at(i); j < level.ChildOffset.at(i + 1); j++)
+        {
+            const int cIdx = IdIdx.at(level.ChildId.at(j));
+            if (cIdx == -1)
+            {
+                present.at(i) = false;
+                continue;
+            }
+            /* children consist of corners of the replaced cell and added vertexes */
+            for (int vIdx : mesh.C.at(cIdx))
+            {
+                if (std::find(parent.begin(), parent.end(), vIdx) != parent.end())
+                    continue;
+                auto it = AddedV.find(vIdx);
+                if (it == AddedV.end())
+                    AddedV[vIdx] = i;
+                else
+                    root.at(findRoot(root, i)) = findRoot(root, it->second);
+            }
+        }
+    }
+
+    std::vector<bool> rootEligible(pnum, true);
+    for (int i = 0; i < pnum; i++)
+        if (!present.at(i))
+            rootEligible.at(findRoot(root, i)) = false;
+
+    eligible.resize(pnum);
+    for (int i = 0; i < pnum; i++)
+    {
+        root.at(i) = findRoot(root, i);
+        eligible.at(i) = rootEligible.at(root.at(i));
+    }
+}
+
+/*
+ * init()
+ * DESCRIPTION: start a history from the given mesh, i.e. no refinement is recorded
+ * INPUT: cellNum - number of cells of the mesh
+ * OUTPUT: ids of cells
+ * RETURN: none
+ */
+void RefineHistory::init(size_t cellNum)
+{
+    CellId.resize(cellNum);
+    for (size_t i = 0; i < cellNum; i++)
+        CellId.at(i) = i;
+    nextId = cellNum;
+    levels.clear();
+}
+
+/*
+ * record()
+ * DESCRIPTION: record a trivial refinement as a new level
+ * INPUT: tree - parent-children map of cells of the refinement
+ *        CellOrigin - index of each cell before refinement, -1 if the cell is new
+ *        coarseC - cells before refinement
+ * OUTPUT: new level, ids of cells of the refined mesh
+ * RETURN: none
+ */
+void RefineHistory::record(const RefineTree &tree, const std::vector<int> &CellOrigin, const std::vector<HexCell> &coarseC)
+{
+    RefineLevel level;
+    std::vector<int> id(tree.childNum());
+
+    level.ChildOffset.push_back(0);
+    for (int p = 0; p < tree.parentNum(); p++)
+    {
+        const int begin = tree.ChildOffset.at(p), end = tree.ChildOffset.at(p + 1);
+
+        /* unrefined cell keeps its id */
+        if (end - begin == 1 && CellOrigin.at(tree.ChildC.at(begin)) == p)
+        {
+            id.at(tree.ChildC.at(begin)) = CellId.at(p);
+            continue;
+        }
+
+        level.ParentId.push_back(CellId.at(p));
+        level.ParentC.push_back(coarseC.at(p));
+        for (int i = begin; i < end; i++)
+        {
+            id.at(tree.ChildC.at(i)) = nextId;
+            level.ChildId.push_back(nextId++);
+        }
+        level.ChildOffset.push_back(level.ChildId.size());
+    }
+
+    CellId.swap(id);
+    if (!level.ParentId.empty())
+        levels.push_back(level);
+}
+
+/*
+ * getCandidates()
+ * DESCRIPTION: get replaced cells of a level which could be restored,
+ *              i.e. children of the whole component are still in the mesh
+ * INPUT: mesh - current mesh
+ *        level - index of the level
+ * OUTPUT: candidates - indexes of replaced cells in the level
+ * RETURN: none
+ */
+void RefineHistory::getCandidates(const HexMesh &mesh, int level, std::vector<int> &candidates) const
+{
+    std::vector<int> IdIdx, root;
+    std::vector<bool> eligible;
+
+    getIdIndex(IdIdx);
+    getComponents(levels.at(level), mesh, IdIdx, root, eligible);
+
+    candidates.clear();
+    for (size_t i = 0; i < eligible.size(); i++)
+        if (eligible.at(i))
+            candidates.push_back(i);
+}
+
+/*
+ * coarsen()
+ * DESCRIPTION: restore replaced cells of a level, a component is restored only if all its replaced cells are resolved
+ *              restored cells are appended to the mesh, vertexes no longer used are removed
+ * INPUT: mesh - current mesh
+ *        level - index of the level
+ *        candidates - replaced cells given by getCandidates()
+ *        resolved - whether each candidate is resolved by the density field
+ * OUTPUT: coarsened mesh, the level is removed if all its replaced cells are restored
+ * RETURN: number of restored cells
+ */
+int RefineHistory::coarsen(HexMesh &mesh, int level, const std::vector<int> &candidates, const std::vector<bool> &resolved)
+{
+    RefineLevel &lv = levels.at(level);
+    const int pnum = lv.ParentId.size();
+    std::vector<int> IdIdx, root;
+    std::vector<bool> eligible;
+
+    getIdIndex(IdIdx);
+    getComponents(lv, mesh, IdIdx, root, eligible);
+
+    /* a component is restored if all its replaced cells are resolved */
+    std::vector<bool> restore(pnum, false);
+    for (size_t k = 0; k < candidates.size(); k++)
+        restore.at(root.at(candidates.at(k))) = true;
+    for (size_t k = 0; k < candidates.size(); k++)
+        if (!resolved.at(k))
+            restore.at(root.at(candidates.at(k))) = false;
+    for (int i = 0; i < pnum; i++)
+        restore.at(i) = eligible.at(i) && restore.at(root.at(i));
+
+    /* remove children of restored cells */
+    std::vector<bool> removed(mesh.C.size(), false);
+    for (int i = 0; i < pnum; i++)
+        if (restore.at(i))
+            for (int j = lv.ChildOffset.at(i); j < lv.ChildOffset.at(i + 1); j++)
+                removed.at(IdIdx.at(lv.ChildId.at(j))) = true;
+
+    size_t cNum = 0;
+    for (size_t i = 0; i < mesh.C.size(); i++)
+    {
+        if (removed.at(i))
+            continue;
+        mesh.C.at(cNum) = mesh.C.at(i);
+        CellId.at(cNum) = CellId.at(i);
+        cNum++;
+    }
+    mesh.C.resize(cNum);
+    CellId.resize(cNum);
+
+    /* append restored cells, keep the others in the level */
+    RefineLevel rest;
+    int restoreNum = 0;
+    rest.ChildOffset.push_back(0);
+    for (int i = 0; i < pnum; i++)
+    {
+        if (restore.at(i))
+        {
+            mesh.C.push_back(lv.ParentC.at(i));
+            CellId.push_back(lv.ParentId.at(i));
+            restoreNum++;
+            continue;
+        }
+        rest.ParentId.push_back(lv.ParentId.at(i));
+        rest.ParentC.push_back(lv.ParentC.at(i));
+        rest.ChildId.insert(rest.ChildId.end(), lv.ChildId.begin() + lv.ChildOffset.at(i), lv.ChildId.begin() + lv.ChildOffset.at(i + 1));
+        rest.ChildOffset.push_back(rest.ChildId.size());
+    }
+
+    if (rest.ParentId.empty())
+        levels.erase(levels.begin() + level);
+    else
+        lv = rest;
+
+    if (restoreNum)
+        compactVertexes(mesh);
+
+    return restoreNum;
+}
+
+/*
+ * getIdIndex()
+ * DESCRIPTION: get index of the cell of each id in the current mesh
+ * INPUT: none
+ * OUTPUT: IdIdx - index of the cell of each id, -1 if not in the mesh
+ * RETURN: none
+ */
+void RefineHistory::getIdIndex(std::vector<int> &IdIdx) const
+{
+    IdIdx.assign(nextId, -1);
+    for (size_t i = 0; i < CellId.size(); i++)
+        IdIdx.at(CellId.at(i)) = i;
+}
+
+/*
+ * compactVertexes()
+ * DESCRIPTION: remove vertexes no longer used by cells, vertex indexes of the mesh and the history are updated
+ * INPUT: mesh - current mesh
+ * OUTPUT: mesh without unused vertexes
+ * RETURN: none
+ */
+void RefineHistory::compactVertexes(HexMesh &mesh)
+{
+    std::vector<int> VMap(mesh.V.size(), -1);
+    for (const HexCell &c : mesh.C)
+        for (int vIdx : c)
+            VMap.at(vIdx) = 0;
+
+    int vNum = 0;
+    for (size_t i = 0; i < mesh.V.size(); i++)
+    {
+        if (VMap.at(i) == -1)
+            continue;
+        VMap.at(i) = vNum;
+        mesh.V.at(vNum++) = mesh.V.at(i);
+    }
+    mesh.V.resize(vNum);
+
+    /* corners of replaced cells stay in the mesh as corners of their children */
+    for (HexCell &c : mesh.C)
+        for (int &vIdx : c)
+            vIdx = VMap.at(vIdx);
+    for (RefineLevel &lv : levels)
+        for (HexCell &c : lv.ParentC)
+            for (int &vIdx : c)
+                vIdx = VMap.at(vIdx);
+}
@@ -0,0 +1,49 @@
+#ifndef REFINE_HISTORY_H
+#define REFINE_HISTORY_H
+
+#include <vector>
+
+#include "HexMesh.h"
+
+/*
+ * RefineLevel
+ * DESCRIPTION: cells replaced by templates in one trivial refinement
+ *              children of parent i are ChildId[ChildOffset[i]] ~ ChildId[ChildOffset[i + 1] - 1]
+ */
+struct RefineLevel
+{
+    std::vector<int> ParentId;    // id of each replaced cell
+    std::vector<HexCell> ParentC; // 8 vertex indexes of each replaced cell
+    std::vector<int> ChildOffset;
+    std::vector<int> ChildId;
+};
+
+/*
+ * RefineHistory
+ * DESCRIPTION: history of trivial refinements of a mesh, used to restore replaced cells, i.e. coarsening
+ *              cells are identified by ids which are kept through refinement and coarsening,
+ *              an unrefined cell keeps its id, a restored cell gets its id before refinement back
+ *              CellId - id of each cell of the current mesh
+ *              levels - one level per refinement, the latest refinement is the last
+ */
+class RefineHistory
+{
+public:
+    std::vector<int> CellId;
+    std::vector<RefineLevel> levels;
+
+    RefineHistory();
+
+    void init(size_t cellNum);
+    void record(const RefineTree &tree, const std::vector<int> &CellOrigin, const std::vector<HexCell> &coarseC);
+    void getCandidates(const HexMesh &mesh, int level, std::vector<int> &candidates) const;
+    int coarsen(HexMesh &mesh, int level, const std::vector<int> &candidates, const std::vector<bool> &resolved);
+
+private:
+    int nextId;
+
+    void getIdIndex(std::vector<int> &IdIdx) const;
+    void compactVertexes(HexMesh &mesh);
+};
+
+#endif
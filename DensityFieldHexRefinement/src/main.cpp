@@ -1,5 +1,8 @@
 #include <iostream>
+#include <cstdio>
 #include "FieldAdaptiveRefine.h"
+#include "BlockRefine.h"
+#include "MeshStore.h"
 #include "MeshIO.h"
 #include "HexEval/HexEval.h"
 
@@ -9,14 +12,27 @@ int main(int argc, char **argv)
 {
     char *input_file = NULL;
     char *output_file = NULL;
+    char *checkpoint_file = NULL;
+    char *json_file = NULL;
+    char default_json[] = "Error.json";
+    char default_checkpoint[] = "refine.ckpt";
     std::string density_metric = "";
     std::string refine_method = "";
     char default_file[] = "../data/cad.vtk";
     bool smooth_flag = false;
     bool mark_flag = false;
     bool eval_flag = false;
+    bool fields_flag = false;
+    bool quality_flag = false;
+    bool resume_flag = false;
     bool help_flag = false;
     int iterNum = 3;
+    int stepNum = 1;
+    int blockCellNum = 0;
+    int processNum = 1;
+    bool budget_flag = false;
+    MarkBudget budget = {0, -1, 0, 0};
+    StopCriteria stop = {0, 0};
 
     /*
    *  A standard command:
@@ -54,6 +70,82 @@ int main(int argc, char **argv)
             assert(i < argc);
             iterNum = std::stoi(argv[i]);
         }
+        else if (!strcmp(argv[i], "-n"))
+        {
+            i++;
+            assert(i < argc);
+            stepNum = std::stoi(argv[i]);
+        }
+        else if (!strcmp(argv[i], "-B"))
+        {
+            i++;
+            assert(i < argc);
+            blockCellNum = std::stoi(argv[i]);
+        }
+        else if (!strcmp(argv[i], "-P"))
+        {
+            i++;
+            assert(i < argc);
+            processNum = std::stoi(argv[i]);
+        }
+        else if (!strcmp(argv[i], "-p"))
+        {
+            i++;
+            assert(i < argc);
+            checkpoint_file = argv[i];
+        }
+        else if (!strcmp(argv[i], "--resume"))
+        {
+            resume_flag = true;
+        }
+        else if (!strcmp(argv[i], "--binary"))
+        {
+            setVtkBinary(true);
+        }
+        else if (!strcmp(argv[i], "--verify"))
+        {
+            setCacheVerify(true);
+        }
+        else if (!strcmp(argv[i], "-c"))
+        {
+            i++;
+            assert(i < argc);
+            stop.minImprovement = std::stod(argv[i]);
+        }
+        else if (!strcmp(argv[i], "-w"))
+        {
+            i++;
+            assert(i < argc);
+            stop.deadline = std::stod(argv[i]);
+        }
+        else if (!strcmp(argv[i], "-k"))
+        {
+            i++;
+            assert(i < argc);
+            budget.maxCellNum = std::stoi(argv[i]);
+            budget_flag = true;
+        }
+        else if (!strcmp(argv[i], "-b"))
+        {
+            i++;
+            assert(i < argc);
+            budget.maxMemory = std::stod(argv[i]);
+            budget_flag = true;
+        }
+        else if (!strcmp(argv[i], "-l"))
+        {
+            i++;
+            assert(i < argc);
+            budget.tolerance = std::stod(argv[i]);
+            budget_flag = true;
+        }
+        else if (!strcmp(argv[i], "-u"))
+        {
+            i++;
+            assert(i < argc);
+            budget.unmarkTolerance = std::stod(argv[i]);
+            budget_flag = true;
+        }
         else if (!strcmp(argv[i], "-s"))
         {
             smooth_flag = true;
@@ -66,6 +158,20 @@ int main(int argc, char **argv)
         {
             eval_flag = true;
         }
+        else if (!strcmp(argv[i], "-f"))
+        {
+            fields_flag = true;
+        }
+        else if (!strcmp(argv[i], "-j"))
+        {
+            i++;
+            assert(i < argc);
+            json_file = argv[i];
+        }
+        else if (!strcmp(argv[i], "-q"))
+        {
+            quality_flag = true;
+        }
         else if (!strcmp(argv[i], "-h"))
         {
             help_flag = true;
@@ -82,18 +188,43 @@ int main(int argc, char **argv)
     {
         std::cout << "Refine hex mesh according to a density field." << std::endl;
         std::cout << "HELP:" << std::endl;
-        std::cout << "-i arg : input vtk file, arg: input vtk file name, default: ../data/cad.vtk" << std::endl;
-        std::cout << "-o arg : output vtk file, arg: output vtk file name, default: output.vtk" << std::endl;
+        std::cout << "-i arg : input vtk file, arg: input .vtk/.vtu/.hmc file name, default: ../data/cad.vtk" << std::endl;
+        std::cout << "-o arg : output vtk file, arg: output vtk file name, .vtu for compressed xml, .hmc for mesh cache, default: output.vtk" << std::endl;
         std::cout << "-d arg : density metric, arg: len/vol, default: len" << std::endl;
         std::cout << "-r arg : refine method, arg: padding/trivial, default: padding" << std::endl;
         std::cout << "-t arg : number of iterations, arg: number of iterations, default: 3" << std::endl;
+        std::cout << "-n arg : number of time steps of a moving density field, coarsen & refine the mesh at each step, default: 1" << std::endl;
+        std::cout << "-B arg : refine out of core block by block, arg: number of cells per block, trivial method only, other options than -i -o -d -r -t -l -P --binary --verify are rejected" << std::endl;
+        std::cout << "-P arg : refine block by block in parallel, arg: number of worker processes, trivial method only, default: 1" << std::endl;
+        std::cout << "-p arg : write a snapshot after each iteration, arg: snapshot file name" << std::endl;
+        std::cout << "--resume : continue from the snapshot of -p instead of the input, not with -n, default: refine.ckpt" << std::endl;
+        std::cout << "-c arg : stop if relative L2 density error improves less than arg (ratio) in one iteration" << std::endl;
+        std::cout << "-w arg : wall-clock deadline in seconds, return the best mesh so far" << std::endl;
+        std::cout << "-k arg : mark at most arg cells with the largest relative error per iteration" << std::endl;
+        std::cout << "-b arg : mark cells so that estimated peak memory stays within arg MB" << std::endl;
+        std::cout << "-l arg : tolerance of relative error, cells within tolerance are not marked, default: 0" << std::endl;
+        std::cout << "-u arg : unmark tolerance, marked cells and their children stay marked until within it, default: -l" << std::endl;
+        std::cout << "--binary : write vtk files in legacy binary format instead of ascii" << std::endl;
+        std::cout << "--verify : verify the checksum of the whole input mesh cache, which reads every page" << std::endl;
         std::cout << "-s     : smooth the padded mesh" << std::endl;
         std::cout << "-m     : output mesh with padded element marked using scalar 1" << std::endl;
-        std::cout << "-e     : evaluate the results, output field of the result mesh, reference & difference field" << std::endl;
+        std::cout << "-e     : evaluate the results, report density error and output Error.json" << std::endl;
+        std::cout << "-f     : with -e, also output Field.vtk, the result mesh with density, reference & difference field" << std::endl;
+        std::cout << "-j arg : with -e, output density error summary in json, arg: json file name, default: Error.json" << std::endl;
+        std::cout << "-q     : report quality of the mesh after each iteration" << std::endl;
         std::cout << "-h     : help" << std::endl;
         return 0;
     }
 
+    /* unmark tolerance is the tolerance by default, i.e. no hysteresis, and never above it */
+    if (budget.unmarkTolerance < 0)
+        budget.unmarkTolerance = budget.tolerance;
+    if (budget.unmarkTolerance > budget.tolerance)
+    {
+        std::cout << "unmark tolerance is larger than tolerance, set to " << budget.tolerance << std::endl;
+        budget.unmarkTolerance = budget.tolerance;
+    }
+
     /* decide density metric */
     HexEval::DensityMetric densityMetric;
     if (density_metric.empty() || density_metric == "len")
@@ -134,32 +265,129 @@ int main(int argc, char **argv)
         return -1;
     }
 
+    /* a snapshot holds no time step, the field of a resumed run would restart at step 0 */
+    if (resume_flag && stepNum > 1)
+    {
+        std::cout << "--resume does not support time steps of -n." << std::endl;
+        return -1;
+    }
+
     Matrix3Xd V;
     MatrixXi C;
     std::function<double(Eigen::Vector3d)> densityField;
     std::function<Eigen::Matrix3d(Eigen::Vector3d)> anisotropicDensityField;
 
-    if (!meshReader((input_file == NULL) ? default_file : input_file, V, C))
+    /* the density field moves along y by shift */
+    auto movingField = [](double shift) -> std::function<double(Vector3d)>
+    {
+        return [shift](Vector3d v)
+               { return 50 * (1 + sin((v.y() - shift) * 3)); };
+    };
+
+    /* block-wise refinement works on binary mesh files, the whole mesh is never held in memory */
+    if (blockCellNum > 0 || processNum > 1)
+    {
+        if (refineMethod != TRIVIAL_REFINE)
+        {
+            std::cout << "block-wise refinement only supports trivial refine method." << std::endl;
+            return -1;
+        }
+        /* options of the in-memory refinement are rejected instead of being ignored */
+        if (stepNum > 1 || checkpoint_file != NULL || resume_flag || stop.minImprovement > 0 || stop.deadline > 0 ||
+            budget.maxCellNum > 0 || budget.maxMemory > 0 || budget.unmarkTolerance != budget.tolerance ||
+            smooth_flag || mark_flag || eval_flag || fields_flag || json_file != NULL || quality_flag)
+        {
+            std::cout << "block-wise refinement only supports -i -o -d -r -t -l -P --binary --verify." << std::endl;
+            return -1;
+        }
+
+        const std::string inName = (input_file == NULL) ? default_file : input_file;
+        const std::string outName = (output_file == NULL) ? "output.vtk" : output_file;
+        const bool storeIn = inName.find(".dfm") != inName.npos, storeOut = outName.find(".dfm") != outName.npos;
+        const std::string storeInName = storeIn ? inName : outName + ".input.dfm";
+        const std::string storeOutName = storeOut ? outName : outName + ".dfm";
+
+        /* a mesh cache is converted from its mapped arrays without being copied into memory */
+        if (inName.find(".hmc") != inName.npos)
+        {
+            MeshCache cache;
+            if (cacheOpen(inName.c_str(), cache) || writeMeshStore(storeInName.c_str(), cache.getV(), cache.getC()) == -1)
+                return -1;
+        }
+        else if (!storeIn)
+        {
+            if (meshReader(inName.c_str(), V, C) || writeMeshStore(storeInName.c_str(), V, C) == -1)
+                return -1;
+            V.resize(3, 0);
+            C.resize(8, 0);
+        }
+
+        if (BlockFieldAdaptiveRefine(storeInName.c_str(), storeOutName.c_str(), movingField(0), densityMetric,
+                                     iterNum, blockCellNum, processNum, budget.tolerance) == -1)
+            return -1;
+        if (!storeIn)
+            std::remove(storeInName.c_str());
+
+        if (!storeOut)
+        {
+            MeshStore store;
+            if (store.open(storeOutName.c_str()) == -1)
+                return -1;
+            if (meshWriter(outName.c_str(), store.getV(), store.getC()) == -1)
+                return -1;
+            store.close();
+            std::remove(storeOutName.c_str());
+        }
+        return 0;
+    }
+
+    /* input is not read when resuming from a snapshot */
+    if (resume_flag && checkpoint_file == NULL)
+        checkpoint_file = default_checkpoint;
+
+    if (resume_flag || !meshReader((input_file == NULL) ? default_file : input_file, V, C))
     {
         // densityField = [](Vector3d v)
         //                {return 258*exp(-v.squaredNorm()/2)/sqrt(2*M_PI);});
         // densityField = [](Vector3d v)
         //                { return 195 * sin(v.y() * 3); }, PADDING_REFINE);
-        densityField = [](Vector3d v)
-                       { return 50 * (1 + sin(v.y() * 3)); };
-        
-        FieldAdaptiveRefine(
-                            V,
-                            C,
-                            densityField,
-                            refineMethod,
-                            densityMetric,
-                            iterNum,
-                            smooth_flag,
-                            mark_flag,
-                            eval_flag
-                            );
-
-        vtkWriter((output_file == NULL) ? "output.vtk" : output_file, V, C);
+        RefineHistory history;
+        const std::string outputName = (output_file == NULL) ? "output.vtk" : output_file;
+        std::string outputExt = ".vtk";
+        if (hasExtension(outputName, ".hmc") || hasExtension(outputName, ".vtu"))
+            outputExt = outputName.substr(outputName.size() - 4);
+        const std::string bestName = outputName + ".best";
+        RefineOptions options;
+        options.method = refineMethod;
+        options.metric = densityMetric;
+        options.iterNum = iterNum;
+        options.stop = stop;
+        options.budget = budget_flag ? &budget : NULL;
+        options.checkpoint = checkpoint_file;
+        options.bestFile = bestName.c_str();
+        options.smooth = smooth_flag;
+        options.mark = mark_flag;
+        options.quality = quality_flag;
+        options.eval = eval_flag;
+        options.fields = fields_flag;
+        options.errorFile = (json_file == NULL) ? default_json : json_file;
+        for (int step = 0; step < stepNum; step++)
+        {
+            /* the density field moves along y by a quarter of its period per time step */
+            densityField = movingField(step * M_PI / 6);
+
+            if (stepNum > 1)
+                std::cout << "\nTime Step " << step << "..." << std::endl;
+
+            options.resume = resume_flag && step == 0;
+            if (FieldAdaptiveRefine(V, C, densityField, options, (stepNum > 1) ? &history : NULL) == -1)
+                return -1;
+
+            if (stepNum > 1 && meshWriter((std::to_string(step) + "step_output" + outputExt).c_str(), V, C) == -1)
+                return -1;
+        }
+
+        if (meshWriter(outputName.c_str(), V, C) == -1)
+            return -1;
     }
 }
\ No newline at end of file
@@ -22,6 +22,8 @@ int main(int argc, char **argv){
         } else if (!strcmp(argv[i],"-output")) {
             i++; assert (i < argc); 
             output_file = argv[i];
+        } else if (!strcmp(argv[i],"-binary")) {
+            setVtkBinary(true);
         } else {
             printf ("Error with command line argument %d: '%s'\n",i,argv[i]);
             assert(0);
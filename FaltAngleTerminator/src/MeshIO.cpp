@@ -13,6 +13,8 @@ using namespace std;
 #include <string>
 #include <vector>
 #include <cstring>
+#include <cstdint>
+#include <algorithm>
 
 #include <vtkPolyData.h>
 #include <vtkGenericDataObjectReader.h>
@@ -20,6 +22,11 @@ using namespace std;
 #include <vtkUnstructuredGridReader.h>
 #include <vtkOBJReader.h>
 #include <vtkCleanPolyData.h>
+#include <vtkXMLUnstructuredGridReader.h>
+#include <vtkCellArray.h>
+#include <vtkDoubleArray.h>
+#include <vtkIdTypeArray.h>
+#include <vtkVersion.h>
 
 #include "MeshIO.h"
 #include "Mesh.h"
@@ -38,6 +45,8 @@ int meshReader(const char* fname, Mesh& mesh)
 
     if (fstring.find(".vtk") != fstring.npos)
         vtkReader(fname, mesh);
+    else if (fstring.find(".vtu") != fstring.npos)
+        vtuReader(fname, mesh);
     else if (fstring.find(".obj") != fstring.npos)
         objReader(fname, mesh);
     else
@@ -45,6 +54,132 @@ int meshReader(const char* fname, Mesh& mesh)
     return 0;
 }
 
+/*
+ * getCellArrays()
+ * DESCRIPTION: copy offsets & connectivity of all cells of a vtk cell array in one go,
+ *              vertexes of cell i are Conn[Offset[i]] ~ Conn[Offset[i + 1] - 1]
+ * INPUT: cells - vtk cell array
+ * OUTPUT: Offset, Conn - cells
+ * RETURN: none
+ */
+static void getCellArrays(vtkCellArray* cells, vector<vtkIdType> &Offset, vector<vtkIdType> &Conn)
+{
+#if VTK_MAJOR_VERSION >= 9
+    vtkSmartPointer<vtkIdTypeArray> offsets = vtkSmartPointer<vtkIdTypeArray>::New();
+    vtkSmartPointer<vtkIdTypeArray> conn = vtkSmartPointer<vtkIdTypeArray>::New();
+    offsets->DeepCopy(cells->GetOffsetsArray());
+    conn->DeepCopy(cells->GetConnectivityArray());
+    Offset.assign(offsets->GetPointer(0), offsets->GetPointer(0) + offsets->GetNumberOfValues());
+    Conn.assign(conn->GetPointer(0), conn->GetPointer(0) + conn->GetNumberOfValues());
+#else
+    /* legacy layout, number of vertexes of each cell followed by its vertexes */
+    const vtkIdType* data = cells->GetData()->GetPointer(0);
+    const vtkIdType size = cells->GetData()->GetNumberOfValues();
+    Offset.assign(1, 0);
+    Conn.clear();
+    Conn.reserve(size);
+    for (vtkIdType i = 0; i < size; i += data[i] + 1)
+    {
+        Conn.insert(Conn.end(), data + i + 1, data + i + 1 + data[i]);
+        Offset.push_back(Conn.size());
+    }
+#endif
+    if (Offset.empty())
+        Offset.push_back(0);
+}
+
+/*
+ * getPointArray()
+ * DESCRIPTION: copy coordinates of all points in one go
+ * INPUT: points - vtk points, could be NULL if there is no point
+ * OUTPUT: none
+ * RETURN: coordinates of points, x y z of each point
+ */
+static vtkSmartPointer<vtkDoubleArray> getPointArray(vtkPoints* points)
+{
+    vtkSmartPointer<vtkDoubleArray> coords = vtkSmartPointer<vtkDoubleArray>::New();
+    if (points != NULL)
+        coords->DeepCopy(points->GetData());
+    return coords;
+}
+
+/*
+ * readUnstructuredGrid()
+ * DESCRIPTION: read mesh from vtk unstructured grid, points and cells are copied from the arrays of the grid in bulk
+ * INPUT: grid - vtk unstructured grid
+ *        mesh - reference to the mesh to be load
+ * OUTPUT: mesh
+ * RETURN: none
+ */
+static void readUnstructuredGrid(vtkUnstructuredGrid* grid, Mesh& mesh)
+{
+    const vtkIdType vnum = grid->GetNumberOfPoints();
+    const vtkIdType cnum = grid->GetNumberOfCells();
+    cout << "UnstructuredGrid: " << vnum << " points " << cnum << " cells" << endl;
+
+    /* read vertexes */
+    vtkSmartPointer<vtkDoubleArray> coords = getPointArray(grid->GetPoints());
+    const double* p = coords->GetPointer(0);
+    vector<Vertex>& V = mesh.V;
+    V.resize(vnum);
+    for (vtkIdType i = 0; i < vnum; i++)
+    {
+        V.at(i).x = p[3 * i];
+        V.at(i).y = p[3 * i + 1];
+        V.at(i).z = p[3 * i + 2];
+    }
+
+    /* read cell type */
+    const vtkIdType cellType = grid->GetCellType(0);
+    if (cellType == VTK_TRIANGLE) mesh.cellType = TRIANGLE;
+    else if (cellType == VTK_QUAD) mesh.cellType = QUAD;
+    else if (cellType == VTK_TETRA) mesh.cellType = TETRAHEDRA;
+    else if (cellType == VTK_HEXAHEDRON) mesh.cellType = HEXAHEDRA;
+
+    /* read cells */
+    vector<vtkIdType> Offset, Conn;
+    getCellArrays(grid->GetCells(), Offset, Conn);
+    vector<Cell>& C = mesh.C;
+    C.resize(Offset.size() - 1);
+    for (size_t i = 0; i < C.size(); i++)
+        C.at(i).assign(Conn.begin() + Offset.at(i), Conn.begin() + Offset.at(i + 1));
+}
+
+/*
+ * readPolyData()
+ * DESCRIPTION: read polygon mesh from vtk polydata, points and polygons are copied from the arrays of the polydata in bulk
+ * INPUT: output - vtk polydata
+ *        mesh - reference to the mesh to be load
+ * OUTPUT: mesh
+ * RETURN: none
+ */
+static void readPolyData(vtkPolyData* output, Mesh& mesh)
+{
+    const vtkIdType vnum = output->GetNumberOfPoints();
+    const vtkIdType cnum = output->GetNumberOfPolys();
+    cout << "PolyData: " << vnum << " points " << cnum << " polys" << endl;
+
+    /* read vertexes */
+    vtkSmartPointer<vtkDoubleArray> coords = getPointArray(output->GetPoints());
+    const double* p = coords->GetPointer(0);
+    vector<Vertex>& V = mesh.V;
+    V.resize(vnum);
+    for (vtkIdType i = 0; i < vnum; i++)
+    {
+        V.at(i).x = p[3 * i];
+        V.at(i).y = p[3 * i + 1];
+        V.at(i).z = p[3 * i + 2];
+    }
+
+    /* read cells */
+    vector<vtkIdType> Offset, Conn;
+    getCellArrays(output->GetPolys(), Offset, Conn);
+    vector<Cell>& C = mesh.C;
+    C.resize(Offset.size() - 1);
+    for (size_t i = 0; i < C.size(); i++)
+        C.at(i).assign(Conn.begin() + Offset.at(i), Conn.begin() + Offset.at(i + 1));
+}
+
 /*
  * vtkReader()
  * DESCRIPTION: read mesh from vtk file
@@ -63,75 +198,28 @@ void vtkReader(const char* fname , Mesh& mesh)
     /* read polydata */
     if (reader->IsFilePolyData())
     {
-        vtkPolyData* output = reader->GetPolyDataOutput();
-        const vtkIdType vnum = output->GetNumberOfPoints();
-        const vtkIdType cnum = output->GetNumberOfPolys();
-        cout << "PolyData: " << vnum << " points " << cnum << " polys" << endl;
-        vector<Vertex>& V = mesh.V;
-        V.resize(vnum);
-        double p[3];
-        for (vtkIdType i = 0; i < vnum; i++)
-        {
-            output->GetPoint(i, p);
-            V.at(i).x = p[0];
-            V.at(i).y = p[1];
-            V.at(i).z = p[2];
-        }
+        readPolyData(reader->GetPolyDataOutput(), mesh);
         mesh.cellType = POLYGON;
-        vector<Cell>& C = mesh.C;
-        for (vtkIdType i = 0; i < cnum; i++)
-        {
-            vtkSmartPointer<vtkIdList> idList = vtkSmartPointer<vtkIdList>::New();
-            output->GetPolys()->GetCell(i, idList);
-            const vtkIdType csize = idList->GetNumberOfIds();
-            Cell c(csize);
-            for (vtkIdType j = 0; j < csize; j++)
-                c.at(j) = idList->GetId(j);
-            C.push_back(c);
-        }
-        C.resize(C.size());
     }
     /* read unstructured grid */
     else if (reader->IsFileUnstructuredGrid())
-    {
-        vtkUnstructuredGrid* output = reader->GetUnstructuredGridOutput();
-        const vtkIdType vnum = output->GetNumberOfPoints();
-        const vtkIdType cnum = output->GetNumberOfCells();
-        cout << "UnstructuredGrid: " << vnum << " points " << cnum << " cells" << endl;
-        vector<Vertex>& V = mesh.V;
-        V.resize(vnum);
-
-        /* read vertexes */
-        double p[3];
-        for (vtkIdType i = 0; i < vnum; i++)
-        {
-            output->GetPoint(i, p);
-            V.at(i).x = p[0];
-            V.at(i).y = p[1];
-            V.at(i).z = p[2];
-        }
-
-        /* read cell type */
-        const vtkIdType cellType = output->GetCellType(0);
-        if (cellType == VTK_TRIANGLE) mesh.cellType = TRIANGLE;
-        else if (cellType == VTK_QUAD) mesh.cellType = QUAD;
-        else if (cellType == VTK_TETRA) mesh.cellType = TETRAHEDRA;
-        else if (cellType == VTK_HEXAHEDRON) mesh.cellType = HEXAHEDRA;
+        readUnstructuredGrid(reader->GetUnstructuredGridOutput(), mesh);
+}
 
-        /* read cells */
-        vector<Cell>& C = mesh.C;
-        for (vtkIdType i = 0; i < cnum; i++)
-        {
-            vtkSmartPointer<vtkIdList> idList = vtkSmartPointer<vtkIdList>::New();
-            output->GetCellPoints(i, idList);
-            const vtkIdType csize = idList->GetNumberOfIds();
-            Cell c(csize);
-            for (vtkIdType j = 0; j < csize; j++)
-                c.at(j) = idList->GetId(j);
-            C.push_back(c);
-        }
-        C.resize(C.size());
-    }
+/*
+ * vtuReader()
+ * DESCRIPTION: read mesh from xml vtk unstructured grid file
+ * INPUT: fname - input filenme
+ *        mesh - reference to the mesh to be load
+ * OUTPUT: mesh
+ * RETURN: none
+ */
+void vtuReader(const char* fname , Mesh& mesh)
+{
+    vtkSmartPointer<vtkXMLUnstructuredGridReader> reader = vtkSmartPointer<vtkXMLUnstructuredGridReader>::New();
+    reader->SetFileName(fname);
+    reader->Update();
+    readUnstructuredGrid(reader->GetOutput(), mesh);
 }
 
 /*
@@ -155,47 +243,54 @@ void objReader(const char* fname , Mesh& mesh)
     cleanFilter->SetInputConnection(reader->GetOutputPort());
     cleanFilter->Update();
 
-    vtkPolyData* output = cleanFilter->GetOutput();
-    const vtkIdType vnum = output->GetNumberOfPoints();
-    const vtkIdType cnum = output->GetNumberOfPolys();
-    std::cout << "PolyData: " << vnum << " points " << cnum << " polys" << std::endl;
-
-    /* read vertexes */
-    std::vector<Vertex>& V = mesh.V;
-    V.resize(vnum);
-    double p[3];
-    for (vtkIdType i = 0; i < vnum; i++)
-    {
-        output->GetPoint(i, p);
-        V.at(i).x = p[0];
-        V.at(i).y = p[1];
-        V.at(i).z = p[2];
-    }
-
     /* read CellType */
+    vtkPolyData* output = cleanFilter->GetOutput();
     const vtkIdType cellType = output->GetCellType(0);
+    readPolyData(output, mesh);
     if (cellType == VTK_TRIANGLE) mesh.cellType = TRIANGLE;
     else if (cellType == VTK_QUAD) mesh.cellType = QUAD;
     else if (cellType == VTK_POLYGON) mesh.cellType = POLYGON;
+}
 
-    /* read cells */
-    std::vector<Cell>& C = mesh.C;
-    for (vtkIdType i = 0; i < cnum; i++)
-    {
-        vtkSmartPointer<vtkIdList> idList = vtkSmartPointer<vtkIdList>::New();
-        output->GetCellPoints(i, idList);
-        const vtkIdType csize = idList->GetNumberOfIds();
-        Cell c(csize);
-        for (vtkIdType j = 0; j < csize; j++)
-            c.at(j) = idList->GetId(j);
-        C.push_back(c);
-    }
-    C.resize(C.size());
+/* whether vtk files are written in binary, see setVtkBinary() */
+static bool vtkBinary = false;
+
+/*
+ * setVtkBinary()
+ * DESCRIPTION: choose the format of vtk files written by vtkWriter()
+ * INPUT: binary - true for legacy binary format, false for ascii
+ * OUTPUT: none
+ * RETURN: none
+ */
+void setVtkBinary(bool binary)
+{
+    vtkBinary = binary;
+}
+
+/*
+ * writeBigEndian()
+ * DESCRIPTION: write an array in one block, legacy vtk binary files are big endian
+ * INPUT: ofs - output stream opened in binary mode
+ *        data - array to be wrote
+ * OUTPUT: data followed by a new line
+ * RETURN: none
+ */
+template <class T>
+static void writeBigEndian(ofstream &ofs, const vector<T> &data)
+{
+    const uint16_t one = 1;
+    vector<char> buf(data.size() * sizeof(T));
+    memcpy(buf.data(), data.data(), buf.size());
+    if (*(const char *)&one == 1)
+        for (size_t i = 0; i < buf.size(); i += sizeof(T))
+            reverse(buf.begin() + i, buf.begin() + i + sizeof(T));
+    ofs.write(buf.data(), buf.size());
+    ofs << '\n';
 }
 
 /*
  * vtkWriter()
- * DESCRIPTION: write mesh into vtk file
+ * DESCRIPTION: write mesh into vtk file, in ascii or binary format, see setVtkBinary()
  * INPUT: fname - output filenme
  *        mesh - reference to the mesh to be wrote
  * OUTPUT: vtk file
@@ -208,34 +303,63 @@ void vtkWriter(const char* fname , Mesh& mesh)
     const size_t vnum = V.size();
     const size_t cnum = C.size();
 
-    ofstream ofs(fname);
+    ofstream ofs(fname, ios::binary);
     /* write standart format */
-    ofs << "# vtk DataFile Version 2.0" << endl
-        << fname << endl
-        << "ASCII" << endl << endl
-        << "DATASET UNSTRUCTURED_GRID" << endl;
+    ofs << "# vtk DataFile Version 2.0\n"
+        << fname << "\n"
+        << (vtkBinary ? "BINARY" : "ASCII") << "\n\n"
+        << "DATASET UNSTRUCTURED_GRID\n";
 
     /* write vertexes */
-    ofs << "POINTS " << vnum << " float" << endl;
-    for (size_t i = 0; i < vnum; i++)
-        ofs << fixed << setprecision(7) << V.at(i).x << " " << V.at(i).y << " " << V.at(i).z << endl;
+    ofs << "POINTS " << vnum << " float\n";
+    if (vtkBinary)
+    {
+        vector<float> P(3 * vnum);
+        for (size_t i = 0; i < vnum; i++)
+        {
+            P.at(3 * i) = V.at(i).x;
+            P.at(3 * i + 1) = V.at(i).y;
+            P.at(3 * i + 2) = V.at(i).z;
+        }
+        writeBigEndian(ofs, P);
+    }
+    else
+    {
+        ofs << fixed << setprecision(7);
+        for (size_t i = 0; i < vnum; i++)
+            ofs << V.at(i).x << " " << V.at(i).y << " " << V.at(i).z << "\n";
+    }
 
     /* write cellType */
     ofs << "CELLS " << cnum << " ";
     vtkIdType idType = VTK_TRIANGLE;
-    if (mesh.cellType == TRIANGLE) ofs << 4*cnum << endl;
-    else if (mesh.cellType == QUAD) {idType = VTK_QUAD;  ofs << 5*cnum << endl;}
-    else if (mesh.cellType == TETRAHEDRA) {idType = VTK_TETRA; ofs << 5*cnum << endl;}
-    else if (mesh.cellType == HEXAHEDRA) {idType = VTK_HEXAHEDRON; ofs << 9*cnum << endl;}
+    if (mesh.cellType == TRIANGLE) ofs << 4*cnum << "\n";
+    else if (mesh.cellType == QUAD) {idType = VTK_QUAD;  ofs << 5*cnum << "\n";}
+    else if (mesh.cellType == TETRAHEDRA) {idType = VTK_TETRA; ofs << 5*cnum << "\n";}
+    else if (mesh.cellType == HEXAHEDRA) {idType = VTK_HEXAHEDRON; ofs << 9*cnum << "\n";}
 
     /* write cells */
+    if (vtkBinary)
+    {
+        vector<int32_t> cells;
+        for (size_t i = 0; i < cnum; i++)
+        {
+            cells.push_back(C.at(i).size());
+            cells.insert(cells.end(), C.at(i).begin(), C.at(i).end());
+        }
+        writeBigEndian(ofs, cells);
+        ofs << "CELL_TYPES " << cnum << "\n";
+        writeBigEndian(ofs, vector<int32_t>(cnum, idType));
+        return;
+    }
+
     for (size_t i = 0; i < cnum; i++){
         ofs << C.at(i).size();
         for (size_t j = 0; j < C.at(i).size(); j++)
             ofs << " " << C.at(i).at(j);
-        ofs << endl;
+        ofs << "\n";
     }
-    ofs << "CELL_TYPES " << cnum << endl;
+    ofs << "CELL_TYPES " << cnum << "\n";
     for (size_t i = 0; i < cnum; i++)
-        ofs << idType << endl;
+        ofs << idType << "\n";
 }
\ No newline at end of file
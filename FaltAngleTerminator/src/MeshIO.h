@@ -5,7 +5,9 @@
 
 int meshReader(const char* fname, Mesh& mesh);
 void vtkReader(const char* fname , Mesh& mesh);
+void vtuReader(const char* fname , Mesh& mesh);
 void objReader(const char* fname , Mesh& mesh);
+void setVtkBinary(bool binary);
 void vtkWriter(const char* fname , Mesh& mesh);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,38 @@
+#ifndef HE_ERROR_H
+#define HE_ERROR_H
+
+#include <vector>
+#include <iostream>
+
+namespace HexEval
+{
+    /* number of bins of the signed error histogram by default */
+    const int ERROR_HIST_BINS = 20;
+
+    /*
+     * ErrorReport
+     * DESCRIPTION: statistics of the error between actual density field and reference density field
+     *              signed error of a cell is (density - reference), negative for under-resolved cells
+     *              l1, l2 - mean absolute error and root mean square error, linf - maximum absolute error
+     *              relative errors are norms of the error over norms of the reference field
+     *              histogram is of signed error over reference, uniform bins over [-1, 1],
+     *              values out of range go to the end bins
+     */
+    struct ErrorReport
+    {
+        int cellNum;
+        int underResolvedNum; // number of cells whose density is lower than the reference
+        double l1, l2, linf;
+        double relL1, relL2, relLinf;
+        double meanSigned;
+        double histMin, histMax;
+        std::vector<int> histogram;
+    };
+
+    void EvalDensityError(const std::vector<double> &Density, const std::vector<double> &RefDensity, ErrorReport &report,
+                          int histBins = ERROR_HIST_BINS);
+    void PrintErrorReport(const ErrorReport &report, std::ostream &os);
+    void PrintErrorReportJson(const ErrorReport &report, std::ostream &os);
+}
+
+#endif
@@ -0,0 +1,327 @@
+#include <cfloat>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <functional>
+#include "heQuality.h"
+#include "HexEval.h"
+
+using namespace HexEval;
+using namespace Eigen;
+
+/* three neighbor vertexes of each corner, ordered so that the corner frame is right-handed for a valid hex */
+static const int HexCornerFrame[8][3] =
+    {
+        {1, 3, 4},
+        {2, 0, 5},
+        {3, 1, 6},
+        {0, 2, 7},
+        {7, 5, 0},
+        {4, 6, 1},
+        {5, 7, 2},
+        {6, 4, 3},
+};
+
+namespace
+{
+    /*
+     * StatsAccumulator
+     * DESCRIPTION: running min, max, sum, histogram and k worst cells of one metric,
+     *              each thread owns one accumulator, accumulators are merged at the end
+     *              badness of a value is -value if smaller is worse, otherwise value
+     *              non-finite or DBL_MAX values of degenerated cells are counted apart, they go to the worst bin
+     *              and are the worst cells, but are excluded from min, max & mean
+     */
+    struct StatsAccumulator
+    {
+        double min, max, sum;
+        int degenerateNum;
+        double histMin, histMax;
+        bool smallIsWorse;
+        size_t k;
+        std::vector<int> histogram;
+        std::vector<std::pair<double, int>> worstHeap; // min-heap of (badness, cell index)
+
+        StatsAccumulator(double hmin, double hmax, int bins, bool smallWorse, int worstK)
+            : min(std::numeric_limits<double>::infinity()), max(-std::numeric_limits<double>::infinity()), sum(0),
+              degenerateNum(0), histMin(hmin), histMax(hmax), smallIsWorse(smallWorse), k(worstK), histogram(bins, 0) {}
+
+        void addWorst(double badness, int cIdx)
+        {
+            if (worstHeap.size() < k)
+            {
+                worstHeap.emplace_back(badness, cIdx);
+                std::push_heap(worstHeap.begin(), worstHeap.end(), std::greater<std::pair<double, int>>());
+            }
+            else if (k > 0 && std::make_pair(badness, cIdx) > worstHeap.front())
+            {
+                std::pop_heap(worstHeap.begin(), worstHeap.end(), std::greater<std::pair<double, int>>());
+                worstHeap.back() = std::make_pair(badness, cIdx);
+                std::push_heap(worstHeap.begin(), worstHeap.end(), std::greater<std::pair<double, int>>());
+            }
+        }
+
+        void add(double value, int cIdx)
+        {
+            const int bins = histogram.size();
+            if (!std::isfinite(value) || value == DBL_MAX)
+            {
+                degenerateNum++;
+                histogram[smallIsWorse ? 0 : bins - 1]++;
+                addWorst(std::numeric_limits<double>::infinity(), cIdx);
+                return;
+            }
+
+            min = std::min(min, value);
+            max = std::max(max, value);
+            sum += value;
+
+            /* clamp before the cast, huge values would overflow int */
+            const double bin = (value - histMin) / (histMax - histMin) * bins;
+            histogram[(int)std::max(0.0, std::min(bins - 1.0, bin))]++;
+
+            addWorst(smallIsWorse ? -value : value, cIdx);
+        }
+
+        void merge(const StatsAccumulator &acc)
+        {
+            min = std::min(min, acc.min);
+            max = std::max(max, acc.max);
+            sum += acc.sum;
+            degenerateNum += acc.degenerateNum;
+            for (size_t i = 0; i < histogram.size(); i++)
+                histogram[i] += acc.histogram[i];
+            for (auto &w : acc.worstHeap)
+                addWorst(w.first, w.second);
+        }
+
+        void finish(int cellNum, QualityStats &stats) const
+        {
+            stats.min = min;
+            stats.max = max;
+            stats.mean = (cellNum > degenerateNum) ? sum / (cellNum - degenerateNum) : 0;
+            stats.degenerateNum = degenerateNum;
+            stats.histMin = histMin;
+            stats.histMax = histMax;
+            stats.histogram = histogram;
+
+            /* worst first */
+            std::vector<std::pair<double, int>> worst = worstHeap;
+            std::sort(worst.begin(), worst.end(), std::greater<std::pair<double, int>>());
+            stats.worst.clear();
+            for (auto &w : worst)
+                stats.worst.push_back(w.second);
+        }
+    };
+}
+
+/*
+ * MinScaledJacobian()
+ * DESCRIPTION: evaluate minimum scaled jacobian at 8 corners of each cell of the batch
+ *              scaled jacobian of a corner is det(e1, e2, e3) / (|e1||e2||e3|), where e1, e2, e3
+ *              are edges from the corner to its neighbor vertexes
+ * INPUT: batch of hex cells
+ * OUTPUT: none
+ * RETURN: minimum scaled jacobian of each cell, in [-1, 1], 0 for cells with degenerated edges
+ */
+ArrayXd HexEval::MinScaledJacobian(const HexBatch &batch)
+{
+    ArrayXd minSJ = ArrayXd::Constant(batch.size, 1.0);
+
+    for (int i = 0; i < 8; i++)
+    {
+        const int n1 = HexCornerFrame[i][0], n2 = HexCornerFrame[i][1], n3 = HexCornerFrame[i][2];
+        const ArrayXd ax = (batch.Px.row(n1) - batch.Px.row(i)).transpose().array();
+        const ArrayXd ay = (batch.Py.row(n1) - batch.Py.row(i)).transpose().array();
+        const ArrayXd az = (batch.Pz.row(n1) - batch.Pz.row(i)).transpose().array();
+        const ArrayXd bx = (batch.Px.row(n2) - batch.Px.row(i)).transpose().array();
+        const ArrayXd by = (batch.Py.row(n2) - batch.Py.row(i)).transpose().array();
+        const ArrayXd bz = (batch.Pz.row(n2) - batch.Pz.row(i)).transpose().array();
+        const ArrayXd cx = (batch.Px.row(n3) - batch.Px.row(i)).transpose().array();
+        const ArrayXd cy = (batch.Py.row(n3) - batch.Py.row(i)).transpose().array();
+        const ArrayXd cz = (batch.Pz.row(n3) - batch.Pz.row(i)).transpose().array();
+
+        const ArrayXd det = ax * (by * cz - bz * cy) + ay * (bz * cx - bx * cz) + az * (bx * cy - by * cx);
+        const ArrayXd len = ((ax.square() + ay.square() + az.square()) *
+                             (bx.square() + by.square() + bz.square()) *
+                             (cx.square() + cy.square() + cz.square()))
+                                .sqrt();
+        minSJ = minSJ.min((len > DBL_MIN).select(det / len, 0.0));
+    }
+    return minSJ;
+}
+
+/*
+ * EdgeRatio()
+ * DESCRIPTION: evaluate ratio of the longest edge to the shortest edge of each cell of the batch
+ * INPUT: batch of hex cells
+ * OUTPUT: none
+ * RETURN: edge ratio of each cell, DBL_MAX for cells with degenerated edges
+ */
+ArrayXd HexEval::EdgeRatio(const HexBatch &batch)
+{
+    ArrayXd minLen = ArrayXd::Constant(batch.size, std::numeric_limits<double>::infinity());
+    ArrayXd maxLen = ArrayXd::Zero(batch.size);
+
+    for (int i = 0; i < 12; i++)
+    {
+        const int v1 = HexEdge[i][0], v2 = HexEdge[i][1];
+        const ArrayXd len = (batch.Px.row(v1) - batch.Px.row(v2)).transpose().array().square() +
+                            (batch.Py.row(v1) - batch.Py.row(v2)).transpose().array().square() +
+                            (batch.Pz.row(v1) - batch.Pz.row(v2)).transpose().array().square();
+        minLen = minLen.min(len);
+        maxLen = maxLen.max(len);
+    }
+    return (minLen > DBL_MIN).select((maxLen / minLen).sqrt(), DBL_MAX);
+}
+
+/*
+ * Skew()
+ * DESCRIPTION: evaluate skew of each cell of the batch, i.e. maximum |cos| of angles between
+ *              three normalized principal axes of the hex
+ * INPUT: batch of hex cells
+ * OUTPUT: none
+ * RETURN: skew of each cell, in [0, 1], DBL_MAX for cells with degenerated principal axes
+ */
+ArrayXd HexEval::Skew(const HexBatch &batch)
+{
+    /* principal axis along edges (a0, a1), (b0, b1), (c0, c1), (d0, d1) of one coordinate */
+    auto axis = [](const Matrix<double, 8, Dynamic> &P, const int e[4][2]) -> ArrayXd
+    {
+        return (P.row(e[0][1]) - P.row(e[0][0]) + P.row(e[1][1]) - P.row(e[1][0]) +
+                P.row(e[2][1]) - P.row(e[2][0]) + P.row(e[3][1]) - P.row(e[3][0]))
+            .transpose()
+            .array();
+    };
+    static const int AxisEdge[3][4][2] =
+        {
+            {{0, 1}, {3, 2}, {4, 5}, {7, 6}},
+            {{0, 3}, {1, 2}, {4, 7}, {5, 6}},
+            {{0, 4}, {1, 5}, {2, 6}, {3, 7}},
+    };
+
+    ArrayXd X[3], Y[3], Z[3];
+    ArrayXd valid = ArrayXd::Ones(batch.size);
+    for (int i = 0; i < 3; i++)
+    {
+        X[i] = axis(batch.Px, AxisEdge[i]);
+        Y[i] = axis(batch.Py, AxisEdge[i]);
+        Z[i] = axis(batch.Pz, AxisEdge[i]);
+        const ArrayXd len = (X[i].square() + Y[i].square() + Z[i].square()).sqrt();
+        valid = (len > DBL_MIN).select(valid, 0.0);
+        X[i] /= len;
+        Y[i] /= len;
+        Z[i] /= len;
+    }
+
+    const ArrayXd cos01 = (X[0] * X[1] + Y[0] * Y[1] + Z[0] * Z[1]).abs();
+    const ArrayXd cos02 = (X[0] * X[2] + Y[0] * Y[2] + Z[0] * Z[2]).abs();
+    const ArrayXd cos12 = (X[1] * X[2] + Y[1] * Y[2] + Z[1] * Z[2]).abs();
+    return (valid > 0).select(cos01.max(cos02).max(cos12), DBL_MAX);
+}
+
+/*
+ * EvalQuality()
+ * DESCRIPTION: evaluate quality of a hex mesh, i.e. minimum scaled jacobian, edge ratio and skew,
+ *              statistics, histograms and worst cells of all metrics are gathered in one parallel pass
+ * INPUT: V - 3xd matrix, each column is a vertex of a mesh
+ *        C - 8xd matrix, each column is a cell of a mesh, each cells contains 8 indexes of 8 vertexes in V
+ *            following vtk convention
+ *        histBins - number of histogram bins
+ *        worstK - number of worst cells recorded for each metric
+ * OUTPUT: report - quality report of the mesh
+ *         scaledJacobian - minimum scaled jacobian of each cell if not null
+ * RETURN: none
+ */
+void HexEval::EvalQuality(const Ref<const Matrix3Xd> &V, const Ref<const MatrixXi> &C, QualityReport &report,
+                          std::vector<double> *scaledJacobian, int histBins, int worstK)
+{
+    const int cnum = C.cols();
+    const int blockNum = (cnum + HEX_BATCH_SIZE - 1) / HEX_BATCH_SIZE;
+
+    StatsAccumulator sjAcc(-1, 1, histBins, true, worstK);
+    StatsAccumulator erAcc(1, 10, histBins, false, worstK);
+    StatsAccumulator skewAcc(0, 1, histBins, false, worstK);
+    int invertedNum = 0;
+
+    if (scaledJacobian)
+        scaledJacobian->resize(cnum);
+
+    #pragma omp parallel
+    {
+        HexBatch batch;
+        StatsAccumulator localSJ(-1, 1, histBins, true, worstK);
+        StatsAccumulator localER(1, 10, histBins, false, worstK);
+        StatsAccumulator localSkew(0, 1, histBins, false, worstK);
+        int localInverted = 0;
+
+        #pragma omp for schedule(dynamic) nowait
+        for (int bIdx = 0; bIdx < blockNum; bIdx++)
+        {
+            const int cBegin = bIdx * HEX_BATCH_SIZE;
+            batch.gather(V, C, cBegin, std::min(cBegin + HEX_BATCH_SIZE, cnum));
+
+            const ArrayXd sj = MinScaledJacobian(batch);
+            const ArrayXd er = EdgeRatio(batch);
+            const ArrayXd skew = Skew(batch);
+
+            for (int b = 0; b < batch.size; b++)
+            {
+                localSJ.add(sj(b), cBegin + b);
+                localER.add(er(b), cBegin + b);
+                localSkew.add(skew(b), cBegin + b);
+                localInverted += (sj(b) <= 0);
+            }
+            if (scaledJacobian)
+                Map<ArrayXd>(scaledJacobian->data() + cBegin, batch.size) = sj;
+        }
+
+        #pragma omp critical
+        {
+            sjAcc.merge(localSJ);
+            erAcc.merge(localER);
+            skewAcc.merge(localSkew);
+            invertedNum += localInverted;
+        }
+    }
+
+    report.cellNum = cnum;
+    report.invertedNum = invertedNum;
+    sjAcc.finish(cnum, report.scaledJacobian);
+    erAcc.finish(cnum, report.edgeRatio);
+    skewAcc.finish(cnum, report.skew);
+}
+
+/*
+ * PrintQualityReport()
+ * DESCRIPTION: print quality report of a hex mesh
+ * INPUT: report - quality report
+ *        os - output stream
+ * OUTPUT: quality report in text
+ * RETURN: none
+ */
+void HexEval::PrintQualityReport(const QualityReport &report, std::ostream &os)
+{
+    const char *names[3] = {"Scaled Jacobian", "Edge Ratio", "Skew"};
+    const QualityStats *stats[3] = {&report.scaledJacobian, &report.edgeRatio, &report.skew};
+
+    os << "Hex quality of " << report.cellNum << " cells, " << report.invertedNum << " inverted" << std::endl;
+    for (int m = 0; m < 3; m++)
+    {
+        const QualityStats &s = *stats[m];
+        os << "  " << names[m] << ": min " << s.min << ", max " << s.max << ", mean " << s.mean;
+        if (s.degenerateNum)
+            os << ", " << s.degenerateNum << " degenerated";
+        os << std::endl;
+
+        os << "    histogram [" << s.histMin << ", " << s.histMax << "]:";
+        for (int count : s.histogram)
+            os << " " << count;
+        os << std::endl;
+
+        os << "    worst cells:";
+        for (int cIdx : s.worst)
+            os << " " << cIdx;
+        os << std::endl;
+    }
+}
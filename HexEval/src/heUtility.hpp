@@ -14,7 +14,7 @@ namespace HexEval
      * OUTPUT: none
      * RETURN: volume of hex cell
      */
-    inline double HexVolume(const Eigen::Matrix3Xd &V, const Eigen::VectorXi &c)
+    inline double HexVolume(const Eigen::Ref<const Eigen::Matrix3Xd> &V, const Eigen::Ref<const Eigen::VectorXi> &c)
     {
         Eigen::Vector3d v0 = V.col(c(0)), v1 = V.col(c(1)), v2 = V.col(c(2)), v3 = V.col(c(3)),
                         v4 = V.col(c(4)), v5 = V.col(c(5)), v6 = V.col(c(6)), v7 = V.col(c(7));
@@ -34,7 +34,7 @@ namespace HexEval
      * OUTPUT: average of values of the reference field at 8 vertexes
      * RETURN: none
      */
-    inline double EvalDensity(const Eigen::Matrix3Xd &V, const Eigen::VectorXi &c, const std::function<double(Eigen::Vector3d)> &DensityField)
+    inline double EvalDensity(const Eigen::Ref<const Eigen::Matrix3Xd> &V, const Eigen::Ref<const Eigen::VectorXi> &c, const std::function<double(Eigen::Vector3d)> &DensityField)
     {
         Eigen::Vector3d v0 = V.col(c(0)), v1 = V.col(c(1)), v2 = V.col(c(2)), v3 = V.col(c(3)),
                         v4 = V.col(c(4)), v5 = V.col(c(5)), v6 = V.col(c(6)), v7 = V.col(c(7));
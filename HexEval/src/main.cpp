@@ -1,7 +1,10 @@
 #include <iostream>
+#include <fstream>
 
 #include "MeshIO.h"
 #include "HexEval.h"
+#include "heQuality.h"
+#include "heError.h"
 
 using namespace Eigen;
 
@@ -10,9 +13,11 @@ int main(int argc, char **argv)
     char *input_file = NULL;
     char *output_file = NULL;
     char *density_metric = NULL;
+    char *json_file = NULL;
     char default_file[] = "../data/cad.vtk";
     bool diff_flag = false;
     bool ref_flag = false;
+    bool quality_flag = false;
     bool help_flag = false;
 
     /* 
@@ -39,6 +44,12 @@ int main(int argc, char **argv)
             assert(i < argc);
             density_metric = argv[i];
         }
+        else if (!strcmp(argv[i], "-j"))
+        {
+            i++;
+            assert(i < argc);
+            json_file = argv[i];
+        }
         else if (!strcmp(argv[i], "-d"))
         {
             diff_flag = true;
@@ -47,6 +58,18 @@ int main(int argc, char **argv)
         {
             ref_flag = true;
         }
+        else if (!strcmp(argv[i], "-q"))
+        {
+            quality_flag = true;
+        }
+        else if (!strcmp(argv[i], "--binary"))
+        {
+            setVtkBinary(true);
+        }
+        else if (!strcmp(argv[i], "--verify"))
+        {
+            setCacheVerify(true);
+        }
         else if (!strcmp(argv[i], "-h"))
         {
             help_flag = true;
@@ -63,11 +86,15 @@ int main(int argc, char **argv)
     {
         std::cout << "Evaluate hex density." << std::endl;
         std::cout << "HELP:" << std::endl;
-        std::cout << "-i arg : input, arg: input file name, default: ../data/cad.vtk" << std::endl;
-        std::cout << "-o arg : output, arg: output file name, default: output.vtk" << std::endl;
+        std::cout << "-i arg : input, arg: input file name, .vtk/.vtu/.hmc, default: ../data/cad.vtk" << std::endl;
+        std::cout << "-o arg : output, arg: output file name, .vtu for compressed xml, .hmc for mesh cache, default: output.vtk" << std::endl;
         std::cout << "-m arg : density metric, arg: len/vol/anisotropic, default: len" << std::endl;
-        std::cout << "-r     : output reference field if setted" << std::endl;
-        std::cout << "-d     : output the difference between the actual density field and the reference field" << std::endl;
+        std::cout << "-r     : add reference field to the output if setted" << std::endl;
+        std::cout << "-d     : add the difference between the actual density field and the reference field to the output" << std::endl;
+        std::cout << "-j arg : output density error summary in json, arg: json file name" << std::endl;
+        std::cout << "-q     : quality mode, report scaled jacobian, edge ratio & skew, output minimum scaled jacobian field" << std::endl;
+        std::cout << "--binary : write vtk files in legacy binary format instead of ascii" << std::endl;
+        std::cout << "--verify : verify the checksum of the whole input mesh cache, which reads every page" << std::endl;
         std::cout << "-h     : help" << std::endl;
         return 0;
     }
@@ -75,7 +102,7 @@ int main(int argc, char **argv)
     Matrix3Xd V;
     MatrixXi C;
     HexEval::HexEvaluator evaluator;
-    std::string densityMetricStr = density_metric;
+    std::string densityMetricStr = (density_metric == NULL) ? "" : density_metric;
     HexEval::DensityMetric densityMetric;
 
     if (density_metric == NULL || densityMetricStr == "len")
@@ -106,39 +133,81 @@ int main(int argc, char **argv)
         return -1;
     }
 
+    std::string inputString = (input_file == NULL) ? default_file : input_file;
     std::string outputString = (output_file == NULL) ? "output.vtk" : output_file;
-    outputString.erase(outputString.length() - 4, 4);
 
-    if (!meshReader((input_file == NULL) ? default_file : input_file, V, C))
+    /* a mesh cache is mapped and used in place, other files are read into V & C */
+    MeshCache cache;
+    const bool cached = inputString.find(".hmc") != inputString.npos;
+    if (cached ? cacheOpen(inputString.c_str(), cache) : meshReader(inputString.c_str(), V, C))
+        return -1;
+    const Map<const Matrix3Xd> MeshV = cached ? cache.getV() : Map<const Matrix3Xd>(V.data(), 3, V.cols());
+    const Map<const MatrixXi> MeshC = cached ? cache.getC() : Map<const MatrixXi>(C.data(), C.rows(), C.cols());
+
+    if (quality_flag)
     {
-        /* set reference density field */
-        evaluator.setRefDensityField([](Vector3d v)
-                                     { return 50 * (1 + sin(v.y() * 3)); });
-        
-        /* if using anisotropic metric, use another type of density field */
-        if (densityMetric == HexEval::ANISOTROPIC_METRIC)
+        /* evaluate quality, then output minimum scaled jacobian of each cell */
+        HexEval::QualityReport report;
+        std::vector<double> scaledJacobian;
+        HexEval::EvalQuality(MeshV, MeshC, report, &scaledJacobian);
+        HexEval::PrintQualityReport(report, std::cout);
+        CacheArray array = {"scaled_jacobian", CACHE_CELL_DATA, CACHE_FLOAT64, 1, scaledJacobian.data()};
+        return meshWriter(outputString.c_str(), MeshV, MeshC, std::vector<CacheArray>(1, array));
+    }
+
+    /* set reference density field */
+    evaluator.setRefDensityField([](Vector3d v)
+                                 { return 50 * (1 + sin(v.y() * 3)); });
+    
+    /* if using anisotropic metric, use another type of density field */
+    if (densityMetric == HexEval::ANISOTROPIC_METRIC)
+    {
+        std::function<Eigen::Matrix3d(Eigen::Vector3d)> isotropicField = [](Vector3d v)
+        { return Eigen::MatrixXd::Identity(3, 3); };
+        evaluator.setAnisotropicDensityField(isotropicField);
+    }
+    
+    /* evaluate the field */
+    if (evaluator.EvalDensityField(MeshV, MeshC, densityMetric) == -1)
+        return -1;
+    
+    /* output fields as named cell arrays of one mesh */
+    std::vector<double> densityField = evaluator.GetDensityField();
+    std::vector<CacheArray> arrays = {{"density", CACHE_CELL_DATA, CACHE_FLOAT64, 1, densityField.data()}};
+    
+    /* if using anisotropic metric, there is no such thing called reference and difference field */
+    if (densityMetric == HexEval::ANISOTROPIC_METRIC)
+        return meshWriter(outputString.c_str(), MeshV, MeshC, arrays);
+
+    /* report error between actual density field and reference field */
+    std::vector<double> refField = evaluator.GetRefDensityField(MeshV, MeshC);
+    HexEval::ErrorReport report;
+    HexEval::EvalDensityError(densityField, refField, report);
+    HexEval::PrintErrorReport(report, std::cout);
+    if (json_file != NULL)
+    {
+        std::ofstream json(json_file);
+        if (!json)
         {
-            std::function<Eigen::Matrix3d(Eigen::Vector3d)> isotropicField = [](Vector3d v)
-            { return Eigen::MatrixXd::Identity(3, 3); };
-            evaluator.setAnisotropicDensityField(isotropicField);
-        }
-        
-        /* evaluate the field */
-        if (evaluator.EvalDensityField(V, C, densityMetric) == -1)
+            std::cout << "cannot open file " << json_file << std::endl;
             return -1;
-        
-        /* output density field */
-        vtkWriter((outputString + ".vtk").c_str(), V, C, evaluator.GetDensityField());
-        
-        /* if using anisotropic metric, there is no such thing called reference and difference field */
-        if (densityMetric == HexEval::ANISOTROPIC_METRIC) return 0;
+        }
+        HexEval::PrintErrorReportJson(report, json);
+    }
 
-        /* output refernce field */
-        if (ref_flag)
-            vtkWriter((outputString + "_reffield.vtk").c_str(), V, C, evaluator.GetRefDensityField(V, C));
-        
-        /* output difference field */
-        if (diff_flag)
-            vtkWriter((outputString + "_difffield.vtk").c_str(), V, C, evaluator.GetDiffDensityField(V, C));
+    /* output refernce field */
+    if (ref_flag)
+        arrays.push_back({"reference", CACHE_CELL_DATA, CACHE_FLOAT64, 1, refField.data()});
+    
+    /* output difference field */
+    std::vector<double> diffField;
+    if (diff_flag)
+    {
+        diffField = densityField;
+        for (size_t cIdx = 0; cIdx < diffField.size(); cIdx++)
+            diffField[cIdx] -= refField[cIdx];
+        arrays.push_back({"difference", CACHE_CELL_DATA, CACHE_FLOAT64, 1, diffField.data()});
     }
-}
\ No newline at end of file
+
+    return meshWriter(outputString.c_str(), MeshV, MeshC, arrays);
+}
@@ -0,0 +1,82 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <eigen3/Eigen/Eigen>
+
+enum CacheLocation
+{
+    CACHE_POINT_DATA,
+    CACHE_CELL_DATA
+};
+
+enum CacheType
+{
+    CACHE_FLOAT64,
+    CACHE_INT32
+};
+
+/*
+ * CacheArray
+ * DESCRIPTION: named array of a mesh cache, components values per vertex or per cell,
+ *              data points to doubles or int32s according to type
+ */
+struct CacheArray
+{
+    std::string name;
+    CacheLocation location;
+    CacheType type;
+    int components;
+    const void *data;
+};
+
+/*
+ * MeshCache
+ * DESCRIPTION: read-only hex mesh mapped from a mesh cache file (.hmc), arrays are used in place without copy
+ *              layout, native byte order
+ *                  header   char[8] magic "HEXCACHE", uint32 version, uint32 number of arrays,
+ *                           uint64 number of vertexes, uint64 number of cells, uint64 checksum,
+ *                           uint64 table checksum, padded to 64 bytes
+ *                  table    64 bytes per array, char[40] name, uint32 location, uint32 type, uint32 components,
+ *                           uint32 reserved, uint64 offset of the data
+ *                  data     each array starts at a multiple of 64 bytes
+ *              the first two arrays are "V", 3 doubles per vertex, & "C", 8 int32 vertex indexes per cell,
+ *              the checksum covers everything after the header, the table checksum covers the header fields
+ *              before the checksum & the table, open() verifies the table checksum & vertex indexes of cells,
+ *              and the checksum only if verify is set, since it reads every page of the file
+ */
+class MeshCache
+{
+public:
+    MeshCache();
+    ~MeshCache();
+
+    int open(const char *fname, bool verify = false);
+    void close();
+
+    size_t vertNum() const { return vnum; }
+    size_t cellNum() const { return cnum; }
+    Eigen::Map<const Eigen::Matrix3Xd> getV() const;
+    Eigen::Map<const Eigen::MatrixXi> getC() const;
+    const std::vector<CacheArray> &getArrays() const { return arrays; }
+    const CacheArray *getArray(const std::string &name) const;
+
+private:
+    const char *data;
+    size_t size;
+    size_t vnum, cnum;
+    std::vector<CacheArray> arrays;
+#ifdef _WIN32
+    void *file, *mapping;
+#endif
+
+    MeshCache(const MeshCache &);
+    MeshCache &operator=(const MeshCache &);
+};
+
+int writeMeshCache(const char *fname, const Eigen::Ref<const Eigen::Matrix3Xd> &V, const Eigen::Ref<const Eigen::MatrixXi> &C,
+                   const std::vector<CacheArray> &arrays = std::vector<CacheArray>());
+
+#endif
@@ -4,9 +4,13 @@
 #include "hpMesh.h"
 
 int meshReader(const char* fname, HexPadding::Mesh& mesh);
+int cacheReader(const char* fname, HexPadding::Mesh& mesh);
 void vtkReader(const char* fname , HexPadding::Mesh& mesh);
+void vtuReader(const char* fname , HexPadding::Mesh& mesh);
 void objReader(const char* fname , HexPadding::Mesh& mesh);
+void setVtkBinary(bool binary);
 void vtkWriter(const char* fname , HexPadding::Mesh& mesh);
 void vtkScalarWriter(const char* fname, HexPadding::Mesh& mesh, std::vector<int> scalarVec);
+int cacheWriter(const char* fname, HexPadding::Mesh& mesh, std::vector<int> scalarVec);
 
 #endif
\ No newline at end of file
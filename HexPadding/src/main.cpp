@@ -53,6 +53,10 @@ int main(int argc, char **argv)
         {
             mark_flag = true;
         }
+        else if (!strcmp(argv[i], "--binary"))
+        {
+            setVtkBinary(true);
+        }
         else if (!strcmp(argv[i], "-h"))
         {
             help_flag = true;
@@ -69,11 +73,12 @@ int main(int argc, char **argv)
     {
         std::cout << "Pad selected hex elements of a hex mesh." << std::endl;
         std::cout << "HELP:" << std::endl;
-        std::cout << "-i arg : input vtk file, arg: input vtk file name, default: ../data/64cube.vtk" << std::endl;
-        std::cout << "-o arg : output vtk file, arg: output vtk file name, default: output.vtk" << std::endl;
+        std::cout << "-i arg : input vtk file, arg: input .vtk/.vtu/.hmc file name, default: ../data/64cube.vtk" << std::endl;
+        std::cout << "-o arg : output vtk file, arg: output vtk file name, .hmc for mesh cache, default: output.vtk" << std::endl;
         std::cout << "-t arg : target cell indexes in txt file, arg: target txt file name, default: ../data/64cube_target.txt" << std::endl;
         std::cout << "-s     : smooth the padded mesh" << std::endl;
         std::cout << "-m     : output mesh with padded element marked using scalar 1" << std::endl;
+        std::cout << "--binary : write vtk files in legacy binary format instead of ascii" << std::endl;
         std::cout << "-h     : help" << std::endl;
         return 0;
     }
@@ -106,14 +111,21 @@ int main(int argc, char **argv)
         HexPadding::padding(mesh, MarkedC, smooth_flag, mark_flag);
         /* output the processed mesh */
         std::string out_name = (output_file == NULL) ? "output.vtk" : output_file;
-        vtkWriter(out_name.c_str(), mesh);
         /* mark padded cells if needed */
+        std::vector<int> PaddedFlag;
         if (mark_flag)
         {
-            std::vector<int> PaddedFlag(mesh.C.size(), 0);
+            PaddedFlag.resize(mesh.C.size(), 0);
             for (size_t cIdx : mesh.PaddedC)
                 PaddedFlag.at(cIdx) = 1;
-            vtkScalarWriter(out_name.c_str(), mesh, PaddedFlag);
+        }
+        if (out_name.find(".hmc") != out_name.npos)
+            cacheWriter(out_name.c_str(), mesh, PaddedFlag);
+        else
+        {
+            vtkWriter(out_name.c_str(), mesh);
+            if (mark_flag)
+                vtkScalarWriter(out_name.c_str(), mesh, PaddedFlag);
         }
     }
     else
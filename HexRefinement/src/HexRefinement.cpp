@@ -34,6 +34,8 @@ int main(int argc, char **argv){
         } else if (!strcmp(argv[i],"-refine")) {
             i++; assert (i < argc); 
             refine_file = argv[i];
+        } else if (!strcmp(argv[i],"-binary")) {
+            setVtkBinary(true);
         } else {
             printf ("Error with command line argument %d: '%s'\n",i,argv[i]);
             assert(0);
@@ -71,7 +73,11 @@ int main(int argc, char **argv){
         /* detect number of flat angles then print it out */
         mesh.refine(selectedV);
         /* output the processed mesh */
-        vtkWriter((output_file == NULL)?"output.vtk":output_file, mesh);
+        std::string out_name = (output_file == NULL)?"output.vtk":output_file;
+        if(out_name.find(".hmc") != out_name.npos)
+            cacheWriter(out_name.c_str(), mesh);
+        else
+            vtkWriter(out_name.c_str(), mesh);
     }else{
         /* fail to read file */
         std::cout << "Fail to read file" << std::endl;
@@ -4,6 +4,8 @@ using namespace std;
 #include <string>
 #include <vector>
 #include <cstring>
+#include <cstdint>
+#include <algorithm>
 
 #include <vtkPolyData.h>
 #include <vtkGenericDataObjectReader.h>
@@ -16,9 +18,45 @@ using namespace std;
 
 #include "MeshIO.h"
 
+/* whether vtk files are written in binary, see setVtkBinary() */
+static bool vtkBinary = false;
+
+/*
+ * setVtkBinary()
+ * DESCRIPTION: choose the format of vtk files written by vtkWriter()
+ * INPUT: binary - true for legacy binary format, false for ascii
+ * OUTPUT: none
+ * RETURN: none
+ */
+void setVtkBinary(bool binary)
+{
+    vtkBinary = binary;
+}
+
+/*
+ * writeBigEndian()
+ * DESCRIPTION: write an array in one block, legacy vtk binary files are big endian
+ * INPUT: ofs - output stream opened in binary mode
+ *        data - array to be wrote
+ * OUTPUT: data followed by a new line
+ * RETURN: none
+ */
+template <class T>
+static void writeBigEndian(ofstream &ofs, const vector<T> &data)
+{
+    const uint16_t one = 1;
+    vector<char> buf(data.size() * sizeof(T));
+    memcpy(buf.data(), data.data(), buf.size());
+    if (*(const char *)&one == 1)
+        for (size_t i = 0; i < buf.size(); i += sizeof(T))
+            reverse(buf.begin() + i, buf.begin() + i + sizeof(T));
+    ofs.write(buf.data(), buf.size());
+    ofs << '\n';
+}
+
 /*
  * vtkWriter()
- * DESCRIPTION: write mesh into vtk file
+ * DESCRIPTION: write mesh into vtk file, in ascii or binary format, see setVtkBinary()
  * INPUT: fname - output filenme
  *        mesh - reference to the mesh to be wrote
  * OUTPUT: vtk file
@@ -29,32 +67,62 @@ void vtkWriter(const char* fname , Eigen::Matrix<float, 3, 27> &P, Eigen::Matrix
     const size_t vnum = 27;
     const size_t cnum = 8;
 
-    ofstream ofs(fname);
+    ofstream ofs(fname, ios::binary);
     /* write standart format */
-    ofs << "# vtk DataFile Version 2.0" << endl
-        << fname << endl
-        << "ASCII" << endl << endl
-        << "DATASET UNSTRUCTURED_GRID" << endl;
+    ofs << "# vtk DataFile Version 2.0\n"
+        << fname << "\n"
+        << (vtkBinary ? "BINARY" : "ASCII") << "\n\n"
+        << "DATASET UNSTRUCTURED_GRID\n";
 
     /* write vertexes */
-    ofs << "POINTS " << vnum << " float" << endl;
-    for (size_t i = 0; i < vnum; i++)
-        ofs << fixed << setprecision(7) << P(0,i) << " " << P(1,i) << " " << P(2,i) << endl;
+    ofs << "POINTS " << vnum << " float\n";
+    if (vtkBinary)
+    {
+        vector<float> points(3 * vnum);
+        for (size_t i = 0; i < vnum; i++)
+        {
+            points.at(3 * i) = P(0,i);
+            points.at(3 * i + 1) = P(1,i);
+            points.at(3 * i + 2) = P(2,i);
+        }
+        writeBigEndian(ofs, points);
+    }
+    else
+    {
+        ofs << fixed << setprecision(7);
+        for (size_t i = 0; i < vnum; i++)
+            ofs << P(0,i) << " " << P(1,i) << " " << P(2,i) << "\n";
+    }
 
     /* write cellType */
     ofs << "CELLS " << cnum << " ";
-    vtkIdType idType = VTK_HEXAHEDRON; ofs << 9*cnum << endl;
+    vtkIdType idType = VTK_HEXAHEDRON; ofs << 9*cnum << "\n";
 
     /* write cells */
+    if (vtkBinary)
+    {
+        vector<int32_t> cells(9 * cnum);
+        for (size_t i = 0; i < cnum; i++)
+        {
+            cells.at(9 * i) = 8;
+            for (size_t j = 0; j < 8; j++)
+                cells.at(9 * i + j + 1) = C(j, i);
+        }
+        writeBigEndian(ofs, cells);
+        ofs << "CELL_TYPES " << cnum << "\n";
+        writeBigEndian(ofs, vector<int32_t>(cnum, idType));
+        return;
+    }
+
     for (size_t i = 0; i < cnum; i++){
         ofs << 8;
         for (size_t j = 0; j < 8; j++)
             ofs << " " << C(j, i);
-        ofs << endl;
+        ofs << "\n";
     }
-    ofs << "CELL_TYPES " << cnum << endl;
+    ofs << "CELL_TYPES " << cnum << "\n";
     for (size_t i = 0; i < cnum; i++)
-        ofs << idType << endl;
+        ofs << idType << "\n";
 }
 
 void vtkWriter(const char* fname , Eigen::Matrix<float, 3, 125> &P, Eigen::Matrix<int, 8, 64> &C)
@@ -62,30 +130,60 @@ void vtkWriter(const char* fname , Eigen::Matrix<float, 3, 125> &P, Eigen::Matri
     const size_t vnum = 125;
     const size_t cnum = 64;
 
-    ofstream ofs(fname);
+    ofstream ofs(fname, ios::binary);
     /* write standart format */
-    ofs << "# vtk DataFile Version 2.0" << endl
-        << fname << endl
-        << "ASCII" << endl << endl
-        << "DATASET UNSTRUCTURED_GRID" << endl;
+    ofs << "# vtk DataFile Version 2.0\n"
+        << fname << "\n"
+        << (vtkBinary ? "BINARY" : "ASCII") << "\n\n"
+        << "DATASET UNSTRUCTURED_GRID\n";
 
     /* write vertexes */
-    ofs << "POINTS " << vnum << " float" << endl;
-    for (size_t i = 0; i < vnum; i++)
-        ofs << fixed << setprecision(7) << P(0,i) << " " << P(1,i) << " " << P(2,i) << endl;
+    ofs << "POINTS " << vnum << " float\n";
+    if (vtkBinary)
+    {
+        vector<float> points(3 * vnum);
+        for (size_t i = 0; i < vnum; i++)
+        {
+            points.at(3 * i) = P(0,i);
+            points.at(3 * i + 1) = P(1,i);
+            points.at(3 * i + 2) = P(2,i);
+        }
+        writeBigEndian(ofs, points);
+    }
+    else
+    {
+        ofs << fixed << setprecision(7);
+        for (size_t i = 0; i < vnum; i++)
+            ofs << P(0,i) << " " << P(1,i) << " " << P(2,i) << "\n";
+    }
 
     /* write cellType */
     ofs << "CELLS " << cnum << " ";
-    vtkIdType idType = VTK_HEXAHEDRON; ofs << 9*cnum << endl;
+    vtkIdType idType = VTK_HEXAHEDRON; ofs << 9*cnum << "\n";
 
     /* write cells */
+    if (vtkBinary)
+    {
+        vector<int32_t> cells(9 * cnum);
+        for (size_t i = 0; i < cnum; i++)
+        {
+            cells.at(9 * i) = 8;
+            for (size_t j = 0; j < 8; j++)
+                cells.at(9 * i + j + 1) = C(j, i);
+        }
+        writeBigEndian(ofs, cells);
+        ofs << "CELL_TYPES " << cnum << "\n";
+        writeBigEndian(ofs, vector<int32_t>(cnum, idType));
+        return;
+    }
+
     for (size_t i = 0; i < cnum; i++){
         ofs << 8;
         for (size_t j = 0; j < 8; j++)
             ofs << " " << C(j, i);
-        ofs << endl;
+        ofs << "\n";
     }
-    ofs << "CELL_TYPES " << cnum << endl;
+    ofs << "CELL_TYPES " << cnum << "\n";
     for (size_t i = 0; i < cnum; i++)
-        ofs << idType << endl;
+        ofs << idType << "\n";
 }
\ No newline at end of file
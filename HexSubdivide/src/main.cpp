@@ -1,8 +1,9 @@
 #include <iostream>
+#include <cstring>
 #include "subdiv.h"
 #include "MeshIO.h"
 
-int main(){
+int main(int argc, char **argv){
     Eigen::Matrix<float, 3, 8> P;
     Eigen::Matrix<float, 3, 27> NewP1To8;
     Eigen::Matrix<float, 3, 125> NewP1To64;
@@ -13,6 +14,10 @@ int main(){
          0, 2, 2, 0, 0, 2, 2, 0,
          0, 0, 2, 2, 0, 0, 2, 2;
 
+    /* ./HexSubdivide.exe -binary writes legacy binary vtk files */
+    if (argc > 1 && !strcmp(argv[1], "-binary"))
+        setVtkBinary(true);
+
     HexDiv1To8(P, NewP1To8, C1To8);
     HexDiv1To64(P, NewP1To64, C1To64);
 
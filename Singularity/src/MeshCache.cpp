@@ -0,0 +1,381 @@
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <cstddef>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "MeshCache.h"
+
+static const char MeshCacheMagic[8] = {'H', 'E', 'X', 'C', 'A', 'C', 'H', 'E'};
+static const uint32_t MeshCacheVersion = 2;
+static const size_t MeshCacheAlign = 64;
+static const size_t MeshCacheNameSize = 40;
+
+/* header of a mesh cache file, see MeshCache */
+struct CacheHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t arrayNum;
+    uint64_t vnum, cnum;
+    uint64_t checksum;
+    uint64_t tableChecksum;
+    char reserved[16];
+};
+
+/* entry of the array table of a mesh cache file */
+struct CacheEntry
+{
+    char name[MeshCacheNameSize];
+    uint32_t location, type, components, reserved;
+    uint64_t offset;
+};
+
+static_assert(sizeof(CacheHeader) == MeshCacheAlign && sizeof(CacheEntry) == MeshCacheAlign, "mesh cache layout");
+
+/* round up to a multiple of MeshCacheAlign */
+static inline uint64_t alignUp(uint64_t n)
+{
+    return (n + MeshCacheAlign - 1) / MeshCacheAlign * MeshCacheAlign;
+}
+
+/*
+ * updateChecksum()
+ * DESCRIPTION: fold bytes into a 64-bit checksum word by word
+ * INPUT: h - checksum of the previous bytes
+ *        p, n - bytes, n is a multiple of 8 except for the last call
+ * OUTPUT: none
+ * RETURN: checksum including the bytes
+ */
+static uint64_t updateChecksum(uint64_t h, const char *p, size_t n)
+{
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        uint64_t w;
+        memcpy(&w, p + i, 8);
+        h = (h ^ w) * 0x100000001b3ULL;
+        h ^= h >> 29;
+    }
+    for (; i < n; i++)
+        h = (h ^ (unsigned char)p[i]) * 0x100000001b3ULL;
+    return h;
+}
+
+static const uint64_t ChecksumSeed = 0xcbf29ce484222325ULL;
+
+/* checksum of the header fields before the checksum & the array table */
+static uint64_t tableChecksum(const CacheHeader &header, const char *table)
+{
+    const uint64_t h = updateChecksum(ChecksumSeed, (const char *)&header, offsetof(CacheHeader, checksum));
+    return updateChecksum(h, table, header.arrayNum * sizeof(CacheEntry));
+}
+
+/* size of one value of an array */
+static inline size_t typeSize(uint32_t type)
+{
+    return (type == CACHE_FLOAT64) ? sizeof(double) : sizeof(int32_t);
+}
+
+/* constructor & destructor for class MeshCache */
+MeshCache::MeshCache() : data(NULL), size(0), vnum(0), cnum(0)
+{
+#ifdef _WIN32
+    file = mapping = NULL;
+#endif
+}
+
+MeshCache::~MeshCache()
+{
+    close();
+}
+
+/*
+ * open()
+ * DESCRIPTION: map a mesh cache file into memory, the layout & table checksum are verified
+ * INPUT: fname - mesh cache file name
+ *        verify - also verify the checksum of the whole file, which reads every page
+ * OUTPUT: mapped mesh & arrays
+ * RETURN: 0 if success, -1 if failed
+ */
+int MeshCache::open(const char *fname, bool verify)
+{
+    close();
+
+#ifdef _WIN32
+    file = CreateFileA(fname, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        file = NULL;
+        std::cout << "cannot open file " << fname << std::endl;
+        return -1;
+    }
+    LARGE_INTEGER fsize;
+    GetFileSizeEx(file, &fsize);
+    size = fsize.QuadPart;
+    mapping = (size >= sizeof(CacheHeader)) ? CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL) : NULL;
+    data = mapping ? (const char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+#else
+    int fd = ::open(fname, O_RDONLY);
+    if (fd == -1)
+    {
+        std::cout << "cannot open file " << fname << std::endl;
+        return -1;
+    }
+    struct stat st;
+    fstat(fd, &st);
+    size = st.st_size;
+    if (size >= sizeof(CacheHeader))
+    {
+        void *addr = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+        data = (addr == MAP_FAILED) ? NULL : (const char *)addr;
+    }
+    ::close(fd);
+#endif
+
+    if (data == NULL)
+    {
+        std::cout << "cannot map file " << fname << std::endl;
+        close();
+        return -1;
+    }
+
+    CacheHeader header;
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, MeshCacheMagic, sizeof(MeshCacheMagic)) || header.version != MeshCacheVersion ||
+        header.arrayNum < 2 || size < sizeof(CacheHeader) + header.arrayNum * sizeof(CacheEntry))
+    {
+        std::cout << fname << " is not a mesh cache file of this version" << std::endl;
+        close();
+        return -1;
+    }
+    if (tableChecksum(header, data + sizeof(CacheHeader)) != header.tableChecksum ||
+        (verify && updateChecksum(ChecksumSeed, data + sizeof(CacheHeader), size - sizeof(CacheHeader)) != header.checksum))
+    {
+        std::cout << fname << " is corrupted, checksum mismatch" << std::endl;
+        close();
+        return -1;
+    }
+
+    /* array table, the first two arrays are vertexes & cells */
+    bool valid = true;
+    for (uint32_t i = 0; i < header.arrayNum && valid; i++)
+    {
+        CacheEntry entry;
+        memcpy(&entry, data + sizeof(CacheHeader) + i * sizeof(CacheEntry), sizeof(entry));
+        entry.name[MeshCacheNameSize - 1] = '\0';
+        const uint64_t num = (entry.location == CACHE_POINT_DATA) ? header.vnum : header.cnum;
+        /* num is bounded by dividing the rest of the file, a corrupted number cannot overflow the product */
+        valid = entry.location <= CACHE_CELL_DATA && entry.type <= CACHE_INT32 && entry.components > 0 &&
+                entry.offset % MeshCacheAlign == 0 && entry.offset <= size &&
+                num <= (size - entry.offset) / (entry.components * (uint64_t)typeSize(entry.type));
+        if (i == 0)
+            valid = valid && !strcmp(entry.name, "V") && entry.location == CACHE_POINT_DATA && entry.type == CACHE_FLOAT64 && entry.components == 3;
+        if (i == 1)
+            valid = valid && !strcmp(entry.name, "C") && entry.location == CACHE_CELL_DATA && entry.type == CACHE_INT32 && entry.components == 8;
+
+        CacheArray array = {entry.name, (CacheLocation)entry.location, (CacheType)entry.type, (int)entry.components, data + entry.offset};
+        arrays.push_back(array);
+    }
+    if (!valid)
+    {
+        std::cout << fname << " has an invalid array table" << std::endl;
+        close();
+        return -1;
+    }
+
+    /* cells are used in place, so every vertex index is range-checked once, in parallel */
+    const int32_t *cells = (const int32_t *)arrays.at(1).data;
+    const long long indexNum = 8 * (long long)header.cnum;
+    long long badNum = 0;
+#pragma omp parallel for reduction(+ : badNum)
+    for (long long i = 0; i < indexNum; i++)
+        badNum += (cells[i] < 0 || (uint64_t)cells[i] >= header.vnum);
+    if (badNum)
+    {
+        std::cout << fname << " has " << badNum << " vertex indexes out of range" << std::endl;
+        close();
+        return -1;
+    }
+
+    vnum = header.vnum;
+    cnum = header.cnum;
+    return 0;
+}
+
+/*
+ * close()
+ * DESCRIPTION: unmap the mesh cache file
+ * INPUT: none
+ * OUTPUT: none
+ * RETURN: none
+ */
+void MeshCache::close()
+{
+#ifdef _WIN32
+    if (data)
+        UnmapViewOfFile(data);
+    if (mapping)
+        CloseHandle(mapping);
+    if (file)
+        CloseHandle(file);
+    file = mapping = NULL;
+#else
+    if (data)
+        munmap((void *)data, size);
+#endif
+    data = NULL;
+    size = vnum = cnum = 0;
+    arrays.clear();
+}
+
+/* 3xd view of vertexes, each column is a vertex */
+Eigen::Map<const Eigen::Matrix3Xd> MeshCache::getV() const
+{
+    return Eigen::Map<const Eigen::Matrix3Xd>(vnum ? (const double *)arrays.at(0).data : nullptr, 3, vnum);
+}
+
+/* 8xd view of cells, each column is a cell */
+Eigen::Map<const Eigen::MatrixXi> MeshCache::getC() const
+{
+    return Eigen::Map<const Eigen::MatrixXi>(cnum ? (const int *)arrays.at(1).data : nullptr, 8, cnum);
+}
+
+/*
+ * getArray()
+ * DESCRIPTION: find an array by name, vertexes & cells are "V" & "C"
+ * INPUT: name - name of the array
+ * OUTPUT: none
+ * RETURN: the array, NULL if not found
+ */
+const CacheArray *MeshCache::getArray(const std::string &name) const
+{
+    for (const CacheArray &array : arrays)
+        if (array.name == name)
+            return &array;
+    return NULL;
+}
+
+/*
+ * writeMeshCache()
+ * DESCRIPTION: write a hex mesh and named arrays into a mesh cache file, see MeshCache
+ * INPUT: fname - mesh cache file name
+ *        V, C - mesh
+ *        arrays - per-vertex or per-cell arrays
+ * OUTPUT: mesh cache file
+ * RETURN: 0 if success, -1 if failed
+ */
+int writeMeshCache(const char *fname, const Eigen::Ref<const Eigen::Matrix3Xd> &V, const Eigen::Ref<const Eigen::MatrixXi> &C,
+                   const std::vector<CacheArray> &arrays)
+{
+    if (C.rows() != 8)
+    {
+        std::cout << "cells of a mesh cache must have 8 vertexes" << std::endl;
+        return -1;
+    }
+
+    /* V & C are written in place if they are dense, and only copied otherwise */
+    Eigen::Matrix3Xd VCopy;
+    Eigen::MatrixXi CCopy;
+    if (V.outerStride() != 3)
+        VCopy = V;
+    if (C.outerStride() != 8)
+        CCopy = C;
+    std::vector<CacheArray> all;
+    CacheArray varray = {"V", CACHE_POINT_DATA, CACHE_FLOAT64, 3, (V.outerStride() != 3) ? VCopy.data() : V.data()};
+    CacheArray carray = {"C", CACHE_CELL_DATA, CACHE_INT32, 8, (C.outerStride() != 8) ? CCopy.data() : C.data()};
+    all.push_back(varray);
+    all.push_back(carray);
+    all.insert(all.end(), arrays.begin(), arrays.end());
+
+    CacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MeshCacheMagic, sizeof(MeshCacheMagic));
+    header.version = MeshCacheVersion;
+    header.arrayNum = all.size();
+    header.vnum = V.cols();
+    header.cnum = C.cols();
+
+    /* table */
+    std::vector<CacheEntry> table(all.size());
+    std::vector<uint64_t> bytes(all.size());
+    uint64_t offset = alignUp(sizeof(CacheHeader) + all.size() * sizeof(CacheEntry));
+    for (size_t i = 0; i < all.size(); i++)
+    {
+        const CacheArray &array = all.at(i);
+        if (array.name.size() >= MeshCacheNameSize || array.components <= 0)
+        {
+            std::cout << "invalid cache array " << array.name << std::endl;
+            return -1;
+        }
+        CacheEntry &entry = table.at(i);
+        memset(&entry, 0, sizeof(entry));
+        memcpy(entry.name, array.name.c_str(), array.name.size());
+        entry.location = array.location;
+        entry.type = array.type;
+        entry.components = array.components;
+        entry.offset = offset;
+        bytes.at(i) = ((array.location == CACHE_POINT_DATA) ? header.vnum : header.cnum) * array.components * typeSize(array.type);
+        offset = alignUp(offset + bytes.at(i));
+    }
+
+    /* write the body with the checksum, then the header */
+    const std::string tmpName = std::string(fname) + ".tmp";
+    std::ofstream ofs(tmpName, std::ios::binary | std::ios::trunc);
+    if (!ofs)
+    {
+        std::cout << "cannot open file " << tmpName << std::endl;
+        return -1;
+    }
+    const std::vector<char> zeros(MeshCacheAlign, 0);
+    uint64_t h = ChecksumSeed;
+    auto append = [&](const char *p, size_t n)
+    {
+        ofs.write(p, n);
+        h = updateChecksum(h, p, n);
+    };
+
+    ofs.write((const char *)&header, sizeof(header));
+    append((const char *)table.data(), table.size() * sizeof(CacheEntry));
+    append(zeros.data(), table.at(0).offset - sizeof(CacheHeader) - table.size() * sizeof(CacheEntry));
+    for (size_t i = 0; i < all.size(); i++)
+    {
+        /* the last bytes of an array are folded together with its padding, so words are the same as when the body is folded at once */
+        const size_t head = bytes.at(i) / 8 * 8;
+        char tail[MeshCacheAlign + 8] = {0};
+        memcpy(tail, (const char *)all.at(i).data + head, bytes.at(i) - head);
+        append((const char *)all.at(i).data, head);
+        append(tail, alignUp(bytes.at(i)) - head);
+    }
+    header.checksum = h;
+    header.tableChecksum = tableChecksum(header, (const char *)table.data());
+    ofs.seekp(0);
+    ofs.write((const char *)&header, sizeof(header));
+    ofs.close();
+    if (!ofs)
+    {
+        std::cout << "failed to write " << tmpName << std::endl;
+        std::remove(tmpName.c_str());
+        return -1;
+    }
+
+    /* rename replaces the previous file atomically on posix, on windows it fails if the target exists */
+#ifdef _WIN32
+    std::remove(fname);
+#endif
+    if (std::rename(tmpName.c_str(), fname))
+    {
+        std::cout << "failed to rename " << tmpName << " to " << fname << std::endl;
+        return -1;
+    }
+    return 0;
+}
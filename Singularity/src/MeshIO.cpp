@@ -0,0 +1,416 @@
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include <charconv>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "MeshIO.hpp"
+#include "ovmIO.hpp"
+#include "Singularity.hpp"
+
+using namespace std;
+
+#define HEX_SIZE 8
+#define VTK_HEX_TYPE 12     /* VTK_HEXAHEDRON */
+
+/*
+ * meshReader()
+ * DESCRIPTION: read hex mesh from file, .ovm files are read with their own edges,
+ *              edges of .vtk & .hmc files are built from the cells
+ * INPUT: fname - input filenme
+ *        mesh - reference to the mesh to be load
+ * OUTPUT: mesh
+ * RETURN: -1 if fail, 0 if success
+ */
+int meshReader(const char *fname, EdgeMesh &mesh)
+{
+    string fstring(fname);
+    vector<Vec3f> V;
+    vector<int> C;
+
+    if (fstring.find(".ovm") != fstring.npos)
+        return ovmReader(fname, mesh);
+    else if (fstring.find(".vtk") != fstring.npos)
+    {
+        if (vtkHexReader(fname, V, C) == -1)
+        {
+            cout << fname << " is not a legacy vtk hex mesh" << endl;
+            return -1;
+        }
+    }
+    else if (fstring.find(".hmc") != fstring.npos)
+    {
+        if (cacheReader(fname, V, C) == -1)
+            return -1;
+    }
+    else
+        return -1;
+    return buildEdgeMesh(V, C, mesh);
+}
+
+/*
+ * cacheReader()
+ * DESCRIPTION: read hex mesh from mesh cache file
+ * INPUT: fname - input filenme
+ * OUTPUT: V, C - mesh
+ * RETURN: -1 if fail, 0 if success
+ */
+int cacheReader(const char *fname, vector<Vec3f> &V, vector<int> &C)
+{
+    MeshCache cache;
+    if (cache.open(fname) == -1)
+        return -1;
+    cout << "MeshCache: " << cache.vertNum() << " points " << cache.cellNum() << " cells" << endl;
+
+    const double *vdata = (const double *)cache.getArray("V")->data;
+    const int *cdata = (const int *)cache.getArray("C")->data;
+    V.resize(cache.vertNum());
+    for (size_t i = 0; i < V.size(); i++)
+        for (int j = 0; j < 3; j++)
+            V.at(i).at(j) = vdata[3 * i + j];
+    C.assign(cdata, cdata + HEX_SIZE * cache.cellNum());
+
+    /* vertex indexes must be in range */
+    for (int vIdx : C)
+        if (vIdx < 0 || (size_t)vIdx >= V.size())
+        {
+            cout << fname << " has invalid cells" << endl;
+            return -1;
+        }
+    return 0;
+}
+
+/* constructor & destructor for class MappedFile */
+MappedFile::MappedFile(const char *fname) : data(NULL), size(0)
+{
+#ifndef _WIN32
+    const int fd = ::open(fname, O_RDONLY);
+    struct stat st;
+    if (fd == -1)
+        return;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+    {
+        void *addr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr != MAP_FAILED)
+        {
+            data = (const char *)addr;
+            size = st.st_size;
+        }
+    }
+    ::close(fd);
+#else
+    ifstream ifs(fname, ios::binary);
+    buf.assign(istreambuf_iterator<char>(ifs), istreambuf_iterator<char>());
+    data = buf.data();
+    size = buf.size();
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+#ifndef _WIN32
+    if (data)
+        munmap((void *)data, size);
+#endif
+}
+
+
+static inline bool isSpace(char c)
+{
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+/*
+ * readLine()
+ * DESCRIPTION: read the next non-empty line of a vtk file
+ * INPUT: p - current position
+ *        end - end of the file
+ * OUTPUT: p - position after the line
+ *         line - the line without line break
+ * RETURN: false if the end of file is reached
+ */
+static bool readLine(const char *&p, const char *end, string &line)
+{
+    while (p < end && isSpace(*p))
+        p++;
+    if (p == end)
+        return false;
+    const char *eol = (const char *)memchr(p, '\n', end - p);
+    if (eol == NULL)
+        eol = end;
+    line.assign(p, eol);
+    if (!line.empty() && line.back() == '\r')
+        line.pop_back();
+    p = (eol == end) ? end : eol + 1;
+    return true;
+}
+
+/*
+ * findSection()
+ * DESCRIPTION: find the end of an ascii section, i.e. the next line starting with a keyword
+ * INPUT: p - start of the section
+ *        end - end of the file
+ * OUTPUT: none
+ * RETURN: start of the next keyword, or end of the file
+ */
+static const char *findSection(const char *p, const char *end)
+{
+    while ((p = (const char *)memchr(p, '\n', end - p)) != NULL)
+    {
+        p++;
+        if (p < end && *p >= 'A' && *p <= 'Z')
+            return p;
+    }
+    return end;
+}
+
+/*
+ * sectionCapacity()
+ * DESCRIPTION: bound the number of values a section could hold, each ascii value takes at least a digit and
+ *              a separator, so counts of a header are checked against the file before anything is allocated
+ * INPUT: p - start of the section
+ *        e - end of the section
+ *        binary - whether values are binary
+ *        typeSize - size of a binary value
+ * OUTPUT: none
+ * RETURN: maximum number of values in [p, e)
+ */
+static size_t sectionCapacity(const char *p, const char *e, bool binary, size_t typeSize)
+{
+    return binary ? (e - p) / typeSize : (e - p + 1) / 2;
+}
+
+/*
+ * parseAscii()
+ * DESCRIPTION: parse whitespace separated numbers of [begin, end) in parallel using from_chars,
+ *              the text is split into chunks at whitespaces, numbers of each chunk are counted first so that
+ *              every chunk knows the index of its first number
+ * INPUT: begin, end - text
+ *        num - expected number of numbers
+ *        store - store(i, value) is called with the ith number, returns false if the value is invalid
+ * OUTPUT: none
+ * RETURN: 0 if success, -1 if the count does not match or a number is ill-formed
+ */
+template <class T, class Store>
+static int parseAscii(const char *begin, const char *end, size_t num, Store store)
+{
+    const size_t chunkSize = 1 << 20;
+    const int chunkNum = (end - begin) / chunkSize + 1;
+    vector<const char *> bound(chunkNum + 1, end);
+    vector<size_t> offset(chunkNum + 1, 0);
+    bound.at(0) = begin;
+    for (int k = 1; k < chunkNum; k++)
+    {
+        const char *p = max(bound.at(k - 1), begin + k * chunkSize);
+        while (p < end && !isSpace(*p))
+            p++;
+        bound.at(k) = p;
+    }
+
+    /* count numbers of each chunk */
+#pragma omp parallel for schedule(dynamic)
+    for (int k = 0; k < chunkNum; k++)
+    {
+        size_t count = 0;
+        for (const char *p = bound.at(k), *e = bound.at(k + 1); p < e;)
+        {
+            while (p < e && isSpace(*p))
+                p++;
+            if (p == e)
+                break;
+            count++;
+            while (p < e && !isSpace(*p))
+                p++;
+        }
+        offset.at(k + 1) = count;
+    }
+    for (int k = 0; k < chunkNum; k++)
+        offset.at(k + 1) += offset.at(k);
+    if (offset.at(chunkNum) != num)
+        return -1;
+
+    /* parse */
+    int failed = 0;
+#pragma omp parallel for schedule(dynamic) reduction(| : failed)
+    for (int k = 0; k < chunkNum; k++)
+    {
+        size_t i = offset.at(k);
+        for (const char *p = bound.at(k), *e = bound.at(k + 1); p < e && !failed;)
+        {
+            while (p < e && isSpace(*p))
+                p++;
+            if (p == e)
+                break;
+            T value;
+            const from_chars_result r = from_chars(p, e, value);
+            if (r.ec != errc() || (r.ptr < e && !isSpace(*r.ptr)) || !store(i++, value))
+                failed = 1;
+            p = r.ptr;
+        }
+    }
+    return failed ? -1 : 0;
+}
+
+/*
+ * parseBinary()
+ * DESCRIPTION: parse big endian numbers of a binary section in parallel
+ * INPUT: begin - start of the section
+ *        num - number of numbers
+ *        store - store(i, value) is called with the ith number, returns false if the value is invalid
+ * OUTPUT: none
+ * RETURN: 0 if success, -1 if a value is invalid
+ */
+template <class T, class Store>
+static int parseBinary(const char *begin, size_t num, Store store)
+{
+    const uint16_t one = 1;
+    const bool swap = (*(const char *)&one == 1);
+    int failed = 0;
+#pragma omp parallel for reduction(| : failed)
+    for (long long i = 0; i < (long long)num; i++)
+    {
+        char bytes[sizeof(T)];
+        memcpy(bytes, begin + i * sizeof(T), sizeof(T));
+        if (swap)
+            reverse(bytes, bytes + sizeof(T));
+        T value;
+        memcpy(&value, bytes, sizeof(T));
+        if (!store(i, value))
+            failed = 1;
+    }
+    return failed ? -1 : 0;
+}
+
+/*
+ * vtkHexReader()
+ * DESCRIPTION: read hex mesh from legacy vtk file (ascii or binary) without vtk library,
+ *              the file is memory-mapped and POINTS, CELLS & CELL_TYPES are parsed in parallel directly into V & C
+ * INPUT: fname - input filenme
+ * OUTPUT: V, C - mesh, vertex indexes of cell i are C[8i] ~ C[8i + 7]
+ * RETURN: -1 if the file is not supported (not an unstructured grid of hex cells, or other sections before cells),
+ *         0 if success
+ */
+int vtkHexReader(const char *fname, vector<Vec3f> &V, vector<int> &C)
+{
+    MappedFile file(fname);
+    if (file.data == NULL)
+        return -1;
+    const char *p = file.data, *end = file.data + file.size;
+    string line, keyword, type;
+
+    /* header, title, format & dataset */
+    if (!readLine(p, end, line) || line.compare(0, 5, "# vtk"))
+        return -1;
+    if (!readLine(p, end, line) || !readLine(p, end, line))
+        return -1;
+    const bool binary = (line.compare(0, 6, "BINARY") == 0);
+    if (!binary && line.compare(0, 5, "ASCII"))
+        return -1;
+    if (!readLine(p, end, line) || line.find("UNSTRUCTURED_GRID") == line.npos)
+        return -1;
+
+    long long vnum = -1, cnum = -1, typeNum = -1;
+    while ((vnum == -1 || cnum == -1 || typeNum == -1) && readLine(p, end, line))
+    {
+        istringstream iss(line);
+        iss >> keyword;
+        if (keyword == "POINTS")
+        {
+            if (!(iss >> vnum >> type) || vnum < 0 || (type != "float" && type != "double"))
+                return -1;
+            const size_t typeSize = (type == "float") ? sizeof(float) : sizeof(double);
+            const char *e = binary ? end : findSection(p, end);
+            /* the section must hold all coordinates before V is allocated */
+            if ((unsigned long long)vnum > sectionCapacity(p, e, binary, typeSize) / 3)
+                return -1;
+            V.resize(vnum);
+            float *data = vnum ? V.at(0).data() : NULL;
+            auto store = [data](size_t i, double x) { data[i] = x; return true; };
+            int ret;
+            if (binary)
+            {
+                ret = (type == "float") ? parseBinary<float>(p, 3 * vnum, store) : parseBinary<double>(p, 3 * vnum, store);
+                p += 3 * vnum * typeSize;
+            }
+            else
+            {
+                ret = parseAscii<double>(p, e, 3 * vnum, store);
+                p = e;
+            }
+            if (ret == -1)
+                return -1;
+        }
+        else if (keyword == "CELLS")
+        {
+            long long size;
+            if (!(iss >> cnum >> size) || cnum < 0 || size < 0)
+                return -1;
+            const char *e = binary ? end : findSection(p, end);
+            /* the section must hold all indexes before C is allocated */
+            if ((unsigned long long)size > sectionCapacity(p, e, binary, sizeof(int32_t)) || cnum > size || size != (HEX_SIZE + 1) * cnum)
+                return -1;
+            C.resize(HEX_SIZE * cnum);
+            int *data = C.data();
+            /* each cell is the number of its vertexes followed by vertex indexes */
+            auto store = [data](size_t i, int x)
+            {
+                const size_t j = i % (HEX_SIZE + 1);
+                if (j == 0)
+                    return x == HEX_SIZE;
+                data[i / (HEX_SIZE + 1) * HEX_SIZE + j - 1] = x;
+                return true;
+            };
+            int ret;
+            if (binary)
+            {
+                ret = parseBinary<int32_t>(p, size, store);
+                p += size * sizeof(int32_t);
+            }
+            else
+            {
+                ret = parseAscii<int>(p, e, size, store);
+                p = e;
+            }
+            if (ret == -1)
+                return -1;
+        }
+        else if (keyword == "CELL_TYPES")
+        {
+            if (!(iss >> typeNum) || typeNum != cnum)
+                return -1;
+            auto store = [](size_t, int x) { return x == VTK_HEX_TYPE; };
+            int ret;
+            if (binary)
+            {
+                if (typeNum * sizeof(int32_t) > (size_t)(end - p))
+                    return -1;
+                ret = parseBinary<int32_t>(p, typeNum, store);
+            }
+            else
+                ret = parseAscii<int>(p, findSection(p, end), typeNum, store);
+            if (ret == -1)
+                return -1;
+        }
+        else
+            return -1;
+    }
+    if (vnum == -1 || cnum == -1 || typeNum == -1)
+        return -1;
+
+    /* vertex indexes must be in range */
+    for (long long i = 0; i < HEX_SIZE * cnum; i++)
+        if (C.at(i) < 0 || C.at(i) >= vnum)
+            return -1;
+
+    cout << "UnstructuredGrid: " << vnum << " points " << cnum << " cells" << endl;
+    return 0;
+}
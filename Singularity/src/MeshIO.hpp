@@ -0,0 +1,36 @@
+#ifndef MESH_IO_HPP
+#define MESH_IO_HPP
+
+#include <vector>
+#include "Singularity.hpp"
+#include "MeshCache.h"
+
+/*
+ * MappedFile
+ * DESCRIPTION: read-only view of a whole file, mapped into memory except on windows where it is read into a buffer,
+ *              data is NULL if the file cannot be read or is empty, the view is not null-terminated
+ */
+class MappedFile
+{
+public:
+    const char *data;
+    size_t size;
+
+    MappedFile(const char *fname);
+    ~MappedFile();
+
+private:
+    std::vector<char> buf;
+
+    MappedFile(const MappedFile &);
+    MappedFile &operator=(const MappedFile &);
+};
+
+/* read hex mesh from .ovm, .vtk or .hmc file into what singularity detection needs */
+int meshReader(const char *fname, EdgeMesh &mesh);
+/* read hex mesh from legacy vtk file without vtk library, 8 vertex indexes per cell */
+int vtkHexReader(const char *fname, std::vector<Vec3f> &V, std::vector<int> &C);
+/* read hex mesh from mesh cache file, 8 vertex indexes per cell */
+int cacheReader(const char *fname, std::vector<Vec3f> &V, std::vector<int> &C);
+
+#endif
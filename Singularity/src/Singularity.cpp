@@ -1,24 +1,204 @@
-#include <OpenVolumeMesh/FileManager/FileManager.hh>
-#include <OpenVolumeMesh/Geometry/VectorT.hh>
-#include <OpenVolumeMesh/Mesh/HexahedralMesh.hh>
-#include <OpenVolumeMesh/Mesh/PolyhedralMesh.hh>
 #include <iostream>
 #include <string>
+#include <algorithm>
+#include <cstdint>
+#include <cmath>
+#include <map>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 #include "Singularity.hpp"
 
+/* vertexes of the 12 edges & the 6 faces of a hex cell, vtk order */
+static const int HexEdge[12][2] = {{0, 1}, {1, 2}, {2, 3}, {3, 0}, {4, 5}, {5, 6},
+                                   {6, 7}, {7, 4}, {0, 4}, {1, 5}, {2, 6}, {3, 7}};
+static const int HexFace[6][4] = {{0, 3, 2, 1}, {4, 5, 6, 7}, {0, 1, 5, 4},
+                                  {1, 2, 6, 5}, {2, 3, 7, 6}, {3, 0, 4, 7}};
+
+/*
+ * radixSort()
+ * DESCRIPTION: stable LSD radix sort of keys in parallel, 8 bits a pass, each thread counts & scatters a block,
+ *              ids are moved along with the keys
+ * INPUT: keys - keys to be sorted
+ *        ids - ids of the keys, or empty
+ *        bits - keys are less than 2^bits
+ * OUTPUT: keys, ids - sorted
+ * RETURN: none
+ */
+static void radixSort(std::vector<uint64_t> &keys, std::vector<int> &ids, int bits)
+{
+    const int bucketNum = 256;
+    const long long n = keys.size();
+    const bool withIds = !ids.empty();
+#ifdef _OPENMP
+    const int blockNum = omp_get_max_threads();
+#else
+    const int blockNum = 1;
+#endif
+    std::vector<uint64_t> keyBuf(n);
+    std::vector<int> idBuf(withIds ? n : 0);
+    std::vector<long long> offset(blockNum * bucketNum);
+
+    for (int shift = 0; shift < bits; shift += 8)
+    {
+        /* count digits of each block */
+#pragma omp parallel for schedule(static, 1)
+        for (int b = 0; b < blockNum; b++)
+        {
+            long long *count = &offset.at(b * bucketNum);
+            std::fill(count, count + bucketNum, 0);
+            for (long long i = n * b / blockNum; i < n * (b + 1) / blockNum; i++)
+                count[(keys[i] >> shift) & (bucketNum - 1)]++;
+        }
+
+        /* output position of each digit of each block, ordered by digit then block to keep the sort stable */
+        long long sum = 0;
+        for (int d = 0; d < bucketNum; d++)
+            for (int b = 0; b < blockNum; b++)
+            {
+                const long long count = offset.at(b * bucketNum + d);
+                offset.at(b * bucketNum + d) = sum;
+                sum += count;
+            }
+
+        /* scatter */
+#pragma omp parallel for schedule(static, 1)
+        for (int b = 0; b < blockNum; b++)
+        {
+            long long *pos = &offset.at(b * bucketNum);
+            for (long long i = n * b / blockNum; i < n * (b + 1) / blockNum; i++)
+            {
+                const long long j = pos[(keys[i] >> shift) & (bucketNum - 1)]++;
+                keyBuf[j] = keys[i];
+                if (withIds)
+                    idBuf[j] = ids[i];
+            }
+        }
+        keys.swap(keyBuf);
+        ids.swap(idBuf);
+    }
+}
+
+/*
+ * buildEdgeMesh()
+ * DESCRIPTION: build edges of a hex mesh with the number of adjacent cells & boundary flag of each edge,
+ *              the 12 edges of every cell are emitted as keys of their sorted vertex pairs and grouped by a radix sort,
+ *              so that each group is an edge & its size is the valence,
+ *              faces are grouped the same way by keys of their smallest vertex & its diagonal vertex, then within
+ *              a group by keys of the other two vertexes, so a face is identified by all of its 4 vertexes,
+ *              a face of only one cell is on the boundary, and so are its edges
+ * INPUT: V - vertexes
+ *        C - vertex indexes of cells, 8 per cell in vtk order
+ *        mesh - reference to the mesh to be built
+ * OUTPUT: mesh
+ * RETURN: 0 if success, -1 if failed
+ */
+int buildEdgeMesh(const std::vector<Vec3f> &V, const std::vector<int> &C, EdgeMesh &mesh)
+{
+    const uint64_t vnum = V.size();
+    const long long cnum = C.size() / 8;
+    int bits = 0;
+    while (bits < 64 && ((vnum * vnum) >> bits))
+        bits++;
+
+    /* keys of edges, smaller vertex * vnum + larger vertex */
+    std::vector<uint64_t> edgeKey(12 * cnum);
+    std::vector<int> noIds;
+#pragma omp parallel for
+    for (long long c = 0; c < cnum; c++)
+        for (int i = 0; i < 12; i++)
+        {
+            const uint64_t v1 = C[8 * c + HexEdge[i][0]], v2 = C[8 * c + HexEdge[i][1]];
+            edgeKey[12 * c + i] = std::min(v1, v2) * vnum + std::max(v1, v2);
+        }
+    radixSort(edgeKey, noIds, bits);
+
+    /* keys of faces, smallest vertex * vnum + its diagonal vertex, & keys of the other two vertexes, by face id */
+    std::vector<uint64_t> faceKey(6 * cnum), sideKey(6 * cnum);
+    std::vector<int> faceId(6 * cnum);
+#pragma omp parallel for
+    for (long long c = 0; c < cnum; c++)
+        for (int i = 0; i < 6; i++)
+        {
+            int k = 0;
+            for (int j = 1; j < 4; j++)
+                if (C[8 * c + HexFace[i][j]] < C[8 * c + HexFace[i][k]])
+                    k = j;
+            const uint64_t v1 = C[8 * c + HexFace[i][k]], v2 = C[8 * c + HexFace[i][(k + 2) % 4]];
+            const uint64_t v3 = C[8 * c + HexFace[i][(k + 1) % 4]], v4 = C[8 * c + HexFace[i][(k + 3) % 4]];
+            faceKey[6 * c + i] = v1 * vnum + v2;
+            sideKey[6 * c + i] = std::min(v3, v4) * vnum + std::max(v3, v4);
+            faceId[6 * c + i] = 6 * c + i;
+        }
+    radixSort(faceKey, faceId, bits);
+
+    /* each group of equal keys is an edge */
+    std::vector<uint64_t> uniqueKey;
+    mesh.V = V;
+    mesh.E.clear();
+    mesh.Valence.clear();
+    for (size_t i = 0, j; i < edgeKey.size(); i = j)
+    {
+        for (j = i + 1; j < edgeKey.size() && edgeKey[j] == edgeKey[i]; j++)
+            ;
+        const Edge e = {(int)(edgeKey[i] / vnum), (int)(edgeKey[i] % vnum)};
+        uniqueKey.push_back(edgeKey[i]);
+        mesh.E.push_back(e);
+        mesh.Valence.push_back(j - i);
+    }
+
+    /* edges of faces of only one cell are on the boundary */
+    size_t nonManifoldNum = 0;
+    mesh.BoundaryE.assign(mesh.E.size(), false);
+    for (size_t i = 0, j; i < faceKey.size(); i = j)
+    {
+        for (j = i + 1; j < faceKey.size() && faceKey[j] == faceKey[i]; j++)
+            ;
+
+        /* faces of the same diagonal are only the same face if their other two vertexes are the same too */
+        if (j - i > 1)
+            std::sort(faceId.begin() + i, faceId.begin() + j, [&](int a, int b)
+                      { return sideKey[a] < sideKey[b]; });
+        for (size_t s = i, t; s < j; s = t)
+        {
+            for (t = s + 1; t < j && sideKey[faceId[t]] == sideKey[faceId[s]]; t++)
+                ;
+            if (t - s > 2)
+                nonManifoldNum++;
+            if (t - s != 1)
+                continue;
+            const int c = faceId[s] / 6, f = faceId[s] % 6;
+            for (int k = 0; k < 4; k++)
+            {
+                const uint64_t v1 = C[8 * c + HexFace[f][k]], v2 = C[8 * c + HexFace[f][(k + 1) % 4]];
+                const uint64_t key = std::min(v1, v2) * vnum + std::max(v1, v2);
+                mesh.BoundaryE.at(std::lower_bound(uniqueKey.begin(), uniqueKey.end(), key) - uniqueKey.begin()) = true;
+            }
+        }
+    }
+    if (nonManifoldNum)
+    {
+        std::cout << nonManifoldNum << " faces are shared by more than 2 cells, the mesh is not a valid hex mesh" << std::endl;
+        return -1;
+    }
+
+    std::cout << "Edges: " << mesh.E.size() << std::endl;
+    return 0;
+}
+
 /*
  * findSingularity()
- * DESCRIPTION: find singular lines of a ovm hex mesh
- * INPUT: mMesh - OpenVolumeMesh hex mesh
- *        innerSingularity - reference to a vector of edges to be filled with inner singular edges
- *        boundarySingularity - reference to a vector of edges to be filled with boundary singular edges
+ * DESCRIPTION: find singular lines of a hex mesh
+ * INPUT: mesh - hex mesh with valence & boundary flag of each edge
+ *        innerSingularity - reference to a vector to be filled with indexes of inner singular edges
+ *        boundarySingularity - reference to a vector to be filled with indexes of boundary singular edges
  * OUTPUT: none
  * RETURN: number of all singular edges
  */
 int findSingularity(
-    OpenVolumeMesh::GeometricPolyhedralMeshV3f &mMesh,
-    std::vector<Edge> &innerSingularity,
-    std::vector<Edge> &boundarySingularity)
+    const EdgeMesh &mesh,
+    std::vector<int> &innerSingularity,
+    std::vector<int> &boundarySingularity)
 {
     int numInnerSingularity = 0;
     int numBoundarySingularity = 0;
@@ -26,23 +206,20 @@ int findSingularity(
     std::cout << "Finding singularities... " << std::endl;
 
     /* find singular edges by iterating edges of the mesh */
-    for (auto e_iter = mMesh.edges_begin(); e_iter != mMesh.edges_end(); ++e_iter)
+    for (size_t eIdx = 0; eIdx < mesh.E.size(); eIdx++)
     {
-        bool isBoundary = mMesh.is_boundary(*e_iter);
-        int valence = mMesh.valence(*e_iter);
+        bool isBoundary = mesh.BoundaryE.at(eIdx);
+        int valence = mesh.Valence.at(eIdx);
 
-        Edge e = mMesh.edge(e_iter.cur_handle());
-
-        /* valence in ovm of a edge is the number of adjacent faces, which is different with our definition */
-        /* therefore, for inner regular edge, valence(ovm) is 4, for boundary regular edge, valence(ovm) is 3 */
+        /* inner regular edge is adjacent to 4 cells, boundary regular edge is adjacent to 2 cells */
         if (!isBoundary && valence != 4)
         {
-            innerSingularity.push_back(e);
+            innerSingularity.push_back(eIdx);
             numInnerSingularity++;
         }
-        else if (isBoundary && valence != 3)
+        else if (isBoundary && valence != 2)
         {
-            boundarySingularity.push_back(e);
+            boundarySingularity.push_back(eIdx);
             numBoundarySingularity++;
         }
     }
@@ -53,3 +230,93 @@ int findSingularity(
     /* return total number of singular edges */
     return numInnerSingularity + numBoundarySingularity;
 }
+
+/*
+ * traceSingularCurves()
+ * DESCRIPTION: chain singular edges into maximal singular curves by walking the graph of singular edges,
+ *              a curve ends at a vertex not adjacent to exactly 2 singular edges, or where the valence changes,
+ *              so that all edges of a curve have the same valence, the rest are closed curves
+ * INPUT: mesh - hex mesh with valence of each edge
+ *        singularity - indexes of singular edges
+ *        curves - reference to a vector to be filled with singular curves
+ * OUTPUT: none
+ * RETURN: number of singular curves
+ */
+int traceSingularCurves(
+    const EdgeMesh &mesh,
+    const std::vector<int> &singularity,
+    std::vector<SingularCurve> &curves)
+{
+    const int sEdgeNum = singularity.size();
+
+    /* singular edges of each vertex, those of vertex v are Adj[Offset[v]] ~ Adj[Offset[v + 1] - 1] */
+    std::vector<int> Offset(mesh.V.size() + 1, 0);
+    std::vector<int> Adj(2 * sEdgeNum);
+    for (int eIdx : singularity)
+    {
+        Offset.at(mesh.E.at(eIdx).at(0) + 1)++;
+        Offset.at(mesh.E.at(eIdx).at(1) + 1)++;
+    }
+    for (size_t v = 0; v < mesh.V.size(); v++)
+        Offset.at(v + 1) += Offset.at(v);
+    std::vector<int> pos(Offset.begin(), Offset.end() - 1);
+    for (int k = 0; k < sEdgeNum; k++)
+    {
+        const Edge &e = mesh.E.at(singularity.at(k));
+        Adj.at(pos.at(e.at(0))++) = k;
+        Adj.at(pos.at(e.at(1))++) = k;
+    }
+
+    /* a curve passes through a vertex of 2 singular edges of the same valence, otherwise it ends there */
+    auto isEnd = [&](int v)
+    {
+        return Offset.at(v + 1) - Offset.at(v) != 2 ||
+               mesh.Valence.at(singularity.at(Adj.at(Offset.at(v)))) != mesh.Valence.at(singularity.at(Adj.at(Offset.at(v) + 1)));
+    };
+
+    /* walk from vertex v along singular edge k until an end vertex or a visited edge */
+    std::vector<char> visited(sEdgeNum, false);
+    auto walk = [&](int v, int k)
+    {
+        SingularCurve curve;
+        curve.valence = mesh.Valence.at(singularity.at(k));
+        curve.length = 0;
+        curve.V.push_back(v);
+        while (!visited.at(k))
+        {
+            visited.at(k) = true;
+            const Edge &e = mesh.E.at(singularity.at(k));
+            const int next = (e.at(0) == v) ? e.at(1) : e.at(0);
+            double len2 = 0;
+            for (int i = 0; i < 3; i++)
+                len2 += (double)(mesh.V.at(next).at(i) - mesh.V.at(v).at(i)) * (mesh.V.at(next).at(i) - mesh.V.at(v).at(i));
+            curve.length += std::sqrt(len2);
+            curve.V.push_back(next);
+            v = next;
+            if (isEnd(v))
+                break;
+            k = (Adj.at(Offset.at(v)) == k) ? Adj.at(Offset.at(v) + 1) : Adj.at(Offset.at(v));
+        }
+        curves.push_back(curve);
+    };
+
+    /* open curves start from end vertexes, the remaining edges form closed curves */
+    for (size_t v = 0; v < mesh.V.size(); v++)
+        if (Offset.at(v + 1) > Offset.at(v) && isEnd(v))
+            for (int i = Offset.at(v); i < Offset.at(v + 1); i++)
+                if (!visited.at(Adj.at(i)))
+                    walk(v, Adj.at(i));
+    for (int k = 0; k < sEdgeNum; k++)
+        if (!visited.at(k))
+            walk(mesh.E.at(singularity.at(k)).at(0), k);
+
+    /* classify curves by valence */
+    std::map<int, int> valenceNum;
+    for (const SingularCurve &curve : curves)
+        valenceNum[curve.valence]++;
+    std::cout << "Number of singular curves: " << curves.size() << std::endl;
+    for (const auto &it : valenceNum)
+        std::cout << "    valence " << it.first << ": " << it.second << std::endl;
+
+    return curves.size();
+}
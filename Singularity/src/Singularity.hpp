@@ -1,20 +1,52 @@
 #ifndef SINGULARITY_HPP
 #define SINGULARITY_HPP
 
-#include <OpenVolumeMesh/FileManager/FileManager.hh>
-#include <OpenVolumeMesh/Geometry/VectorT.hh>
-#include <OpenVolumeMesh/Mesh/HexahedralMesh.hh>
-#include <OpenVolumeMesh/Mesh/PolyhedralMesh.hh>
+#include <array>
+#include <vector>
 #include <iostream>
 #include <string>
 
-typedef OpenVolumeMesh::VectorT<float, 3> Vec3f;
-typedef OpenVolumeMesh::OpenVolumeMeshEdge Edge;
+typedef std::array<float, 3> Vec3f;
+typedef std::array<int, 2> Edge;    /* indexes of the two vertexes of an edge */
 
-/* find singular lines of a ovm hex mesh */
+/*
+ * EdgeMesh
+ * DESCRIPTION: what singular edge detection needs of a hex mesh, vertexes, edges,
+ *              and the number of adjacent cells & boundary flag of each edge
+ */
+struct EdgeMesh
+{
+    std::vector<Vec3f> V;
+    std::vector<Edge> E;
+    std::vector<int> Valence;       /* number of cells adjacent to each edge */
+    std::vector<char> BoundaryE;    /* whether each edge is on the boundary */
+};
+
+/*
+ * SingularCurve
+ * DESCRIPTION: chain of singular edges of the same valence, vertexes are in order along the curve,
+ *              the first vertex is also the last one of a closed curve
+ */
+struct SingularCurve
+{
+    std::vector<int> V;
+    int valence;
+    double length;
+};
+
+/* build edges with valence & boundary flag from hex cells */
+int buildEdgeMesh(const std::vector<Vec3f> &V, const std::vector<int> &C, EdgeMesh &mesh);
+
+/* find singular lines of a hex mesh */
 int findSingularity(
-    OpenVolumeMesh::GeometricPolyhedralMeshV3f &mMesh,
-    std::vector<Edge> &innerSingularity,
-    std::vector<Edge> &boundarySingularity);
+    const EdgeMesh &mesh,
+    std::vector<int> &innerSingularity,
+    std::vector<int> &boundarySingularity);
+
+/* chain singular edges into singular curves */
+int traceSingularCurves(
+    const EdgeMesh &mesh,
+    const std::vector<int> &singularity,
+    std::vector<SingularCurve> &curves);
 
-#endif
\ No newline at end of file
+#endif
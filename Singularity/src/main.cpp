@@ -1,6 +1,10 @@
 #include <iostream>
 #include <string>
+#include <cstring>
+#include <cstdio>
+#include <cassert>
 #include "Singularity.hpp"
+#include "MeshIO.hpp"
 #include "vtkIO.hpp"
 
 using namespace std;
@@ -41,20 +45,29 @@ int main(int argc, char **argv){
     }
 
     /* open a mesh file */
-    OpenVolumeMesh::GeometricPolyhedralMeshV3f mMesh;
-    OpenVolumeMesh::IO::FileManager fm;
-    std::cout << fm.readFile(inputFname == NULL ? defaultInputFname : inputFname, mMesh) << std::endl;
+    EdgeMesh mesh;
+    if (meshReader(inputFname == NULL ? defaultInputFname : inputFname, mesh))
+    {
+        std::cout << "Fail to read file" << std::endl;
+        return -1;
+    }
+
+    vector<int>     innerSingularity;
+    vector<int>     boundarySingularity;
 
-    vector<Edge>    innerSingularity;
-    vector<Edge>    boundarySingularity;
+    /* find inner and boundary singular edges */
+    findSingularity(mesh, innerSingularity, boundarySingularity);
 
-    /* find inner and boundary singular lines */
-    findSingularity(mMesh, innerSingularity, boundarySingularity);
+    /* chain singular edges into inner and boundary singular lines */
+    vector<SingularCurve>   innerCurves;
+    vector<SingularCurve>   boundaryCurves;
+    traceSingularCurves(mesh, innerSingularity, innerCurves);
+    traceSingularCurves(mesh, boundarySingularity, boundaryCurves);
 
     /* write inner and boundary singular lines into vtk files */
-    vtkSingularitiesWriter( mMesh, innerSingularity, 
+    vtkSingularitiesWriter( mesh, innerCurves, 
                             innerOutputFname == NULL ? defaultInnerOutputFname : innerOutputFname);
-    vtkSingularitiesWriter( mMesh, boundarySingularity, 
+    vtkSingularitiesWriter( mesh, boundaryCurves, 
                             boundaryOutputFname == NULL ? defaultBoundaryOutputFname : boundaryOutputFname);
 
     return 0;
@@ -0,0 +1,171 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <charconv>
+
+#include "ovmIO.hpp"
+#include "MeshIO.hpp"
+#include "Singularity.hpp"
+
+using namespace std;
+
+static inline bool isSpace(char c)
+{
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+/* skip spaces, return false if the end of file is reached */
+static inline bool skipSpace(const char *&p, const char *end)
+{
+    while (p < end && isSpace(*p))
+        p++;
+    return p < end;
+}
+
+/* read the next word, i.e. a run of non-space characters */
+static bool readWord(const char *&p, const char *end, string &word)
+{
+    skipSpace(p, end);
+    const char *begin = p;
+    while (p < end && !isSpace(*p))
+        p++;
+    word.assign(begin, p);
+    return !word.empty();
+}
+
+/* read the next number, i.e. an integer or a float */
+template <typename T>
+static bool readNumber(const char *&p, const char *end, T &x)
+{
+    if (!skipSpace(p, end))
+        return false;
+    const from_chars_result r = from_chars(p, end, x);
+    if (r.ec != errc())
+        return false;
+    p = r.ptr;
+    return true;
+}
+
+/* read a section header, i.e. its name followed by the number of elements */
+static bool readSection(const char *&p, const char *end, const char *name, long &num)
+{
+    string word;
+    return readWord(p, end, word) && word == name && readNumber(p, end, num) && num >= 0;
+}
+
+/*
+ * readIndexLists()
+ * DESCRIPTION: read a section of index lists, e.g. faces & polyhedra, each line is the number of indexes
+ *              followed by the indexes, the lists are stored in flat arrays
+ * INPUT: p - cursor of the text, moved to the end of the section
+ *        end - end of the text
+ *        num - number of lists
+ *        maxIdx - indexes should be in [0, maxIdx)
+ * OUTPUT: Offset, Idx - indexes of list i are Idx[Offset[i]] ~ Idx[Offset[i + 1] - 1]
+ * RETURN: true if success, false if the section is broken
+ */
+static bool readIndexLists(const char *&p, const char *end, long num, long maxIdx, vector<int> &Offset, vector<int> &Idx)
+{
+    Offset.resize(num + 1);
+    Offset.at(0) = 0;
+    Idx.clear();
+    Idx.reserve(num * 6);
+    for (long i = 0; i < num; i++)
+    {
+        long k, idx;
+        if (!readNumber(p, end, k) || k < 0)
+            return false;
+        for (long j = 0; j < k; j++)
+        {
+            if (!readNumber(p, end, idx) || idx < 0 || idx >= maxIdx)
+                return false;
+            Idx.push_back(idx);
+        }
+        Offset.at(i + 1) = Idx.size();
+    }
+    return true;
+}
+
+/*
+ * ovmReader()
+ * DESCRIPTION: read hex mesh from ascii ovm file (OpenVolumeMesh standard file) without OpenVolumeMesh,
+ *              instead of the half-face structure only vertexes, edges, edges of each face and
+ *              whether each face is on the boundary are built, then the valence & boundary flag of each edge
+ *              faces refer to half-edges (2 * edge + orientation), polyhedra refer to half-faces (2 * face + orientation)
+ * INPUT: fname - input filenme
+ *        mesh - reference to the mesh to be load
+ * OUTPUT: mesh
+ * RETURN: 0 if success, -1 if failed
+ */
+int ovmReader(const char *fname, EdgeMesh &mesh)
+{
+    /* the text is parsed in place from the mapped file */
+    MappedFile file(fname);
+    if (file.data == NULL)
+    {
+        cout << "cannot open file " << fname << endl;
+        return -1;
+    }
+    const char *p = file.data, *end = file.data + file.size;
+
+    string word;
+    long vnum, enum_, fnum, cnum;
+    if (!readWord(p, end, word) || word != "OVM" || !readWord(p, end, word) || word != "ASCII")
+    {
+        cout << fname << " is not an ascii ovm file" << endl;
+        return -1;
+    }
+
+    /* vertexes */
+    bool valid = readSection(p, end, "Vertices", vnum);
+    mesh.V.resize(valid ? vnum : 0);
+    for (long i = 0; valid && i < vnum; i++)
+        for (int j = 0; j < 3 && valid; j++)
+            valid = readNumber(p, end, mesh.V.at(i).at(j));
+
+    /* edges */
+    valid = valid && readSection(p, end, "Edges", enum_);
+    mesh.E.resize(valid ? enum_ : 0);
+    for (long i = 0; valid && i < enum_; i++)
+        for (int j = 0; j < 2 && valid; j++)
+        {
+            long vIdx;
+            valid = readNumber(p, end, vIdx) && vIdx >= 0 && vIdx < vnum;
+            mesh.E.at(i).at(j) = vIdx;
+        }
+
+    /* half-edges of faces & half-faces of cells */
+    vector<int> FaceOffset, FaceEdge, CellOffset, CellFace;
+    valid = valid && readSection(p, end, "Faces", fnum) && readIndexLists(p, end, fnum, 2 * enum_, FaceOffset, FaceEdge);
+    valid = valid && readSection(p, end, "Polyhedra", cnum) && readIndexLists(p, end, cnum, 2 * fnum, CellOffset, CellFace);
+    if (!valid)
+    {
+        cout << fname << " is broken" << endl;
+        return -1;
+    }
+    cout << "OVM: " << vnum << " vertices " << enum_ << " edges " << fnum << " faces " << cnum << " polyhedra" << endl;
+
+    /* a face is on the boundary if one of its half-faces belongs to no cell */
+    vector<char> FaceCellNum(fnum, 0);
+    for (int hf : CellFace)
+        FaceCellNum.at(hf / 2)++;
+
+    /* an edge is on the boundary if it is adjacent to a boundary face */
+    vector<int> EdgeFaceNum(enum_, 0);
+    mesh.BoundaryE.assign(enum_, false);
+    for (long f = 0; f < fnum; f++)
+        for (int i = FaceOffset.at(f); i < FaceOffset.at(f + 1); i++)
+        {
+            const int eIdx = FaceEdge.at(i) / 2;
+            EdgeFaceNum.at(eIdx)++;
+            if (FaceCellNum.at(f) < 2)
+                mesh.BoundaryE.at(eIdx) = true;
+        }
+
+    /* around an inner edge, faces & cells alternate, around a boundary edge there is one more face than cells */
+    mesh.Valence.resize(enum_);
+    for (long e = 0; e < enum_; e++)
+        mesh.Valence.at(e) = EdgeFaceNum.at(e) - (mesh.BoundaryE.at(e) ? 1 : 0);
+
+    return 0;
+}
@@ -0,0 +1,9 @@
+#ifndef OVM_IO_H
+#define OVM_IO_H
+
+#include "Singularity.hpp"
+
+/* read hex mesh from ovm file, only what singularity detection needs is built */
+int ovmReader(const char *fname, EdgeMesh &mesh);
+
+#endif
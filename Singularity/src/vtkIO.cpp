@@ -3,12 +3,13 @@
 #if USING_VTK
     #include <vtkSmartPointer.h>
     #include <vtkPoints.h> 
-    #include <vtkLine.h>
+    #include <vtkPolyLine.h>
+    #include <vtkIntArray.h>
+    #include <vtkDoubleArray.h>
     #include <vtkPolyDataWriter.h>
     #include <vtkPolyData.h>
     #include <vtkPointData.h>
     #include <vtkCellData.h>
-    #include <vtkCleanPolyData.h>
 #endif
 
 #include <fstream>
@@ -22,50 +23,81 @@
 
 using namespace std;
 
+/*
+ * compactVertexes()
+ * DESCRIPTION: number the vertexes referenced by singular curves consecutively
+ * INPUT: mesh - hex mesh
+ *        curves - singular curves
+ * OUTPUT: Remap - new index of each vertex of the mesh, -1 if not referenced
+ *         Used - vertexes of the mesh in the order of new indexes
+ * RETURN: none
+ */
+static void compactVertexes(const EdgeMesh &mesh, const std::vector<SingularCurve> &curves,
+                            std::vector<int> &Remap, std::vector<int> &Used)
+{
+    Remap.assign(mesh.V.size(), -1);
+    Used.clear();
+    for (const SingularCurve &curve : curves)
+        for (int v : curve.V)
+            if (Remap.at(v) == -1)
+            {
+                Remap.at(v) = Used.size();
+                Used.push_back(v);
+            }
+}
+
 #if USING_VTK   /* using vtk library I/O functions */
 
 /*
  * vtkSingularitiesWriter()
- * DESCRIPTION: write singular lines into a vtk file
- * INPUT: mMesh - OpenVolumeMesh hex mesh
- *        singularity - reference to the vector of singular edges to be wrote
+ * DESCRIPTION: write singular curves into a vtk file as poly lines, only referenced vertexes are wrote,
+ *              valence, length & number of edges of each curve are wrote as cell data
+ * INPUT: mesh - hex mesh
+ *        curves - reference to the vector of singular curves to be wrote
  *        fname - output filenme
  * OUTPUT: vtk file
  * RETURN: none
  */
-void vtkSingularitiesWriter(OpenVolumeMesh::GeometricPolyhedralMeshV3f &mMesh,
-    std::vector<Edge> &singularity, const char* fname)
+void vtkSingularitiesWriter(const EdgeMesh &mesh,
+    const std::vector<SingularCurve> &curves, const char* fname)
 {
+    vector<int> Remap, Used;
+    compactVertexes(mesh, curves, Remap, Used);
+
     vtkSmartPointer<vtkPoints> sVertex = vtkSmartPointer<vtkPoints>::New();
     vtkSmartPointer<vtkCellArray> sCells = vtkSmartPointer<vtkCellArray>::New();
+    vtkSmartPointer<vtkIntArray> valence = vtkSmartPointer<vtkIntArray>::New();
+    vtkSmartPointer<vtkDoubleArray> length = vtkSmartPointer<vtkDoubleArray>::New();
+    vtkSmartPointer<vtkIntArray> edgeNum = vtkSmartPointer<vtkIntArray>::New();
+    valence->SetName("valence");
+    length->SetName("length");
+    edgeNum->SetName("edges");
+
+    for (int v : Used){
+        const Vec3f &p = mesh.V.at(v);
+        sVertex->InsertNextPoint(p.at(0), p.at(1), p.at(2));
+    }
 
-    for(size_t i = 0; i < singularity.size(); i++){
-        Edge e = singularity.at(i);
-        Vec3f v1 = mMesh.vertex(e.from_vertex());
-        Vec3f v2 = mMesh.vertex(e.to_vertex());
-        vtkSmartPointer<vtkLine> sLine = vtkSmartPointer<vtkLine>::New();
-
-        sVertex->InsertNextPoint(v1.data()[0], v1.data()[1], v1.data()[2]);
-        sVertex->InsertNextPoint(v2.data()[0], v2.data()[1], v2.data()[2]);
-
-        sLine->GetPointIds()->SetId(0, 2*i);
-        sLine->GetPointIds()->SetId(1, 2*i+1);
+    for (const SingularCurve &curve : curves){
+        vtkSmartPointer<vtkPolyLine> sLine = vtkSmartPointer<vtkPolyLine>::New();
+        sLine->GetPointIds()->SetNumberOfIds(curve.V.size());
+        for (size_t i = 0; i < curve.V.size(); i++)
+            sLine->GetPointIds()->SetId(i, Remap.at(curve.V.at(i)));
         sCells->InsertNextCell(sLine);
+        valence->InsertNextValue(curve.valence);
+        length->InsertNextValue(curve.length);
+        edgeNum->InsertNextValue(curve.V.size() - 1);
     }
 
-    vtkSmartPointer<vtkPolyData> sPolygonPolyData = vtkSmartPointer<vtkPolyData>::New();
-    sPolygonPolyData->SetPoints(sVertex);
-    sPolygonPolyData->SetPolys(sCells);
-
-    /* clean polydata, merge repetitive points */
-    vtkSmartPointer<vtkCleanPolyData> cleanFilter = vtkSmartPointer<vtkCleanPolyData>::New();
-    cleanFilter->SetInputData(sPolygonPolyData);
-    cleanFilter->Update();
-    vtkPolyData* output = cleanFilter->GetOutput();
+    vtkSmartPointer<vtkPolyData> sPolyData = vtkSmartPointer<vtkPolyData>::New();
+    sPolyData->SetPoints(sVertex);
+    sPolyData->SetLines(sCells);
+    sPolyData->GetCellData()->AddArray(valence);
+    sPolyData->GetCellData()->AddArray(length);
+    sPolyData->GetCellData()->AddArray(edgeNum);
 
     vtkSmartPointer<vtkPolyDataWriter> vtkWriter = vtkSmartPointer<vtkPolyDataWriter>::New();
-    vtkWriter->SetInputData(output);
-    // vtkWriter->SetInputData(sPolygonPolyData);
+    vtkWriter->SetInputData(sPolyData);
     vtkWriter->SetFileName(fname);
     vtkWriter->Write();
 }
@@ -74,19 +106,24 @@ void vtkSingularitiesWriter(OpenVolumeMesh::GeometricPolyhedralMeshV3f &mMesh,
 
 /*
  * vtkSingularitiesWriter()
- * DESCRIPTION: write singular lines into a vtk file
- * INPUT: mMesh - OpenVolumeMesh hex mesh
- *        singularity - reference to the vector of singular edges to be wrote
+ * DESCRIPTION: write singular curves into a vtk file as poly lines, only referenced vertexes are wrote,
+ *              valence, length & number of edges of each curve are wrote as cell data
+ * INPUT: mesh - hex mesh
+ *        curves - reference to the vector of singular curves to be wrote
  *        fname - output filenme
  * OUTPUT: vtk file
  * RETURN: none
  */
-void vtkSingularitiesWriter(OpenVolumeMesh::GeometricPolyhedralMeshV3f &mMesh,
-    std::vector<Edge> &singularity, const char* fname)
+void vtkSingularitiesWriter(const EdgeMesh &mesh,
+    const std::vector<SingularCurve> &curves, const char* fname)
 {
-    const size_t vNum = mMesh.n_vertices();
-    const size_t sEdgeNum = singularity.size();
-    const size_t sVertexNum = 2*sEdgeNum;
+    vector<int> Remap, Used;
+    compactVertexes(mesh, curves, Remap, Used);
+
+    const size_t curveNum = curves.size();
+    size_t lineSize = 0;
+    for (const SingularCurve &curve : curves)
+        lineSize += curve.V.size() + 1;
 
     /* standard vtk file format */
     std::ofstream ofs(fname);
@@ -94,32 +131,35 @@ void vtkSingularitiesWriter(OpenVolumeMesh::GeometricPolyhedralMeshV3f &mMesh,
         << fname << endl
         << "ASCII" << endl << endl
         << "DATASET POLYDATA" << endl;
-    ofs << "POINTS " << vNum << " float" << endl;
+    ofs << "POINTS " << Used.size() << " float" << '\n';
 
-    /* write points of singular edges */
-    for (auto v_iter = mMesh.vertices_begin(); v_iter != mMesh.vertices_end(); ++v_iter){
-        Vec3f v = mMesh.vertex(v_iter.cur_handle());
-        ofs << std::fixed << setprecision(7) << v.data()[0] << " " << v.data()[1] << " " << v.data()[2] << endl;
+    /* write points of singular curves */
+    ofs << std::fixed << setprecision(7);
+    for (int v : Used){
+        const Vec3f &p = mesh.V.at(v);
+        ofs << p.at(0) << " " << p.at(1) << " " << p.at(2) << '\n';
     }
 
-    /* write vertices of singular edges */
-    // ofs << "VERTICES " << sVertexNum << " " << 2 * sVertexNum << endl;
-    // for(size_t i = 0; i < singularity.size(); i++){
-    //     Edge e = singularity.at(i);
-    //     int v1Idx = e.from_vertex().idx();
-    //     int v2Idx = e.to_vertex().idx();
-    //     ofs << "1 " << v1Idx << std::endl;
-    //     ofs << "1 " << v2Idx << std::endl;
-    // }
-
-    /* write singular edges */
-    ofs << "LINES " << sEdgeNum << " " << 3 * sEdgeNum << endl;
-    for(size_t i = 0; i < singularity.size(); i++){
-        Edge e = singularity.at(i);
-        int v1Idx = e.from_vertex().idx();
-        int v2Idx = e.to_vertex().idx();
-        ofs << "2 " << v1Idx << " " << v2Idx << std::endl;
+    /* write singular curves */
+    ofs << "LINES " << curveNum << " " << lineSize << '\n';
+    for (const SingularCurve &curve : curves){
+        ofs << curve.V.size();
+        for (int v : curve.V)
+            ofs << " " << Remap.at(v);
+        ofs << '\n';
     }
+
+    /* write statistics of singular curves */
+    ofs << "CELL_DATA " << curveNum << '\n';
+    ofs << "SCALARS valence int 1" << '\n' << "LOOKUP_TABLE default" << '\n';
+    for (const SingularCurve &curve : curves)
+        ofs << curve.valence << '\n';
+    ofs << "SCALARS length float 1" << '\n' << "LOOKUP_TABLE default" << '\n';
+    for (const SingularCurve &curve : curves)
+        ofs << curve.length << '\n';
+    ofs << "SCALARS edges int 1" << '\n' << "LOOKUP_TABLE default" << '\n';
+    for (const SingularCurve &curve : curves)
+        ofs << curve.V.size() - 1 << '\n';
 }
 
 #endif
\ No newline at end of file
@@ -3,9 +3,9 @@
 
 #include "Singularity.hpp"
 
-/* write singular lines into vtk file */
-void vtkSingularitiesWriter(OpenVolumeMesh::GeometricPolyhedralMeshV3f &mMesh,
-                            std::vector<Edge> &singularity,
+/* write singular curves into vtk file */
+void vtkSingularitiesWriter(const EdgeMesh &mesh,
+                            const std::vector<SingularCurve> &curves,
                             const char *fname);
 
 #endif
\ No newline at end of file